@@ -15,6 +15,27 @@ Chart::Chart() {
 	shift = 0;
 }
 
+Chart::~Chart() {
+	UnpinCores();
+}
+
+// The chart and the assist panel read the cores of the work queue, so they are kept resident
+void Chart::PinCores() {
+	UnpinCores();
+	for(int i = 0; i < work_queue.GetCount(); i++) {
+		CoreItem& ci = *work_queue[i];
+		if (ci.core.IsEmpty()) continue;
+		ci.core->Pin();
+		pinned.Add(&*ci.core);
+	}
+}
+
+void Chart::UnpinCores() {
+	for(int i = 0; i < pinned.GetCount(); i++)
+		pinned[i]->Unpin();
+	pinned.Clear();
+}
+
 void Chart::Init(int symbol, const FactoryDeclaration& decl, int tf) {
 	this->decl = decl;
 	this->symbol = symbol;
@@ -33,10 +54,12 @@ void Chart::RefreshCore() {
 	indi_ids.Add(decl);
 	tf_ids.Add(tf);
 	sym_ids.Add(symbol);
+	UnpinCores();
 	work_queue.Clear();
 	sys.GetCoreQueue(work_queue, sym_ids, tf_ids, indi_ids);
 	
 	RefreshCoreData(true);
+	PinCores();
 	
 	Core* src = &*work_queue.Top()->core;
 	if (!src) return;
@@ -52,9 +75,7 @@ void Chart::RefreshCore() {
 }
 
 void Chart::RefreshCoreData(bool store_cache) {
-	System& sys = GetSystem();
-	for (int i = 0; i < work_queue.GetCount(); i++)
-		sys.Process(*work_queue[i], store_cache);
+	GetSystem().ProcessQueue(work_queue, store_cache);
 }
 
 void Chart::ContextMenu(Bar& bar) {
@@ -13,6 +13,7 @@ protected:
 	friend class Overlook;
 	
 	Vector<Ptr<CoreItem> > work_queue;
+	Vector<Core*> pinned;
 	Array<GraphCtrl> graphs;
 	Splitter split;
 	FactoryDeclaration decl;
@@ -30,10 +31,13 @@ protected:
 	void SetTimeValueTool(bool enable);
 	void GraphMouseMove(Point pt, GraphCtrl* g);
 	void Refresh0() {ParentCtrl::Refresh();}
+	void PinCores();
+	void UnpinCores();
 	
 public:
 	typedef Chart CLASSNAME;
 	Chart();
+	~Chart();
 	
 	void PostRefresh() {PostCallback(THISBACK(Refresh0));}
 	void ClearCores();
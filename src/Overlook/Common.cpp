@@ -2,6 +2,174 @@
 
 namespace Overlook {
 
+void BufferData::Realize() {
+	if (!mapped)
+		return;
+	const double* src = mapped;
+	int count = mapped_count;
+	mapped = NULL;
+	mapped_count = 0;
+	mapped_capacity = 0;
+	mapped_stored = 0;
+	data.Reserve(count + 512);
+	data.SetCount(count);
+	if (count)
+		memcpy(data.Begin(), src, count * sizeof(double));
+}
+
+void BufferData::Prefetch(int begin, int end) const {
+	if (!mapped)
+		return;
+	
+	// Touch every page of the range
+	volatile double sum = 0;
+	const int page_values = 4096 / sizeof(double);
+	begin = max(begin, 0);
+	end = min(end, mapped_count);
+	for(int i = begin; i < end; i += page_values)
+		sum += mapped[i];
+}
+
+static double GetCorrelation(double n, double sum_a, double sum_b, double sum_ab, double sum_aa, double sum_bb) {
+	double var_a = sum_aa - sum_a * sum_a / n;
+	double var_b = sum_bb - sum_b * sum_b / n;
+	
+	// A flat window can leave a rounding residue instead of zero variance
+	if (var_a <= sum_aa * 1e-12 || var_b <= sum_bb * 1e-12)
+		return 0.0;
+	
+	double cov = sum_ab - sum_a * sum_b / n;
+	double c = cov / sqrt(var_a * var_b);
+	return max(-1.0, min(+1.0, c));
+}
+
+void RollingCorrelation::Clear() {
+	shift_a = 0;
+	shift_b = 0;
+	sum_a = 0;
+	sum_b = 0;
+	sum_ab = 0;
+	sum_aa = 0;
+	sum_bb = 0;
+	cursor = 0;
+	count = 0;
+}
+
+void RollingCorrelation::Renormalize() {
+	double mean_a = sum_a / count;
+	double mean_b = sum_b / count;
+	shift_a += mean_a;
+	shift_b += mean_b;
+	sum_a = 0;
+	sum_b = 0;
+	sum_ab = 0;
+	sum_aa = 0;
+	sum_bb = 0;
+	for(int i = 0; i < count; i++) {
+		double a = (win_a[i] -= mean_a);
+		double b = (win_b[i] -= mean_b);
+		sum_a += a;
+		sum_b += b;
+		sum_ab += a * b;
+		sum_aa += a * a;
+		sum_bb += b * b;
+	}
+}
+
+double RollingCorrelation::Get() const {
+	if (count < 2)
+		return 0.0;
+	return GetCorrelation(count, sum_a, sum_b, sum_ab, sum_aa, sum_bb);
+}
+
+void RollingDeviation::Renormalize() {
+	double mean = sum / count;
+	shift += mean;
+	sum = 0;
+	sum_sq = 0;
+	for(int i = 0; i < count; i++) {
+		double v = (win[i] -= mean);
+		sum += v;
+		sum_sq += v * v;
+	}
+}
+
+void CorrelationMatrix::SetSize(int series, int period) {
+	this->series = series;
+	this->period = period;
+	win.SetCount(series * period, 0);
+	shift.SetCount(series, 0);
+	sum.SetCount(series, 0);
+	cross.SetCount(series * series, 0);
+	Clear();
+}
+
+void CorrelationMatrix::Clear() {
+	for(double& d : shift) d = 0;
+	for(double& d : sum) d = 0;
+	for(double& d : cross) d = 0;
+	cursor = 0;
+	count = 0;
+}
+
+void CorrelationMatrix::Add(const double* row) {
+	if (count == 0)
+		for(int i = 0; i < series; i++)
+			shift[i] = row[i];
+	
+	double* w = win.Begin() + cursor * series;
+	if (count == period) {
+		for(int i = 0; i < series; i++) {
+			double a = w[i];
+			sum[i] -= a;
+			double* c = cross.Begin() + i * series;
+			for(int j = i; j < series; j++)
+				c[j] -= a * w[j];
+		}
+	}
+	else count++;
+	
+	for(int i = 0; i < series; i++)
+		w[i] = row[i] - shift[i];
+	for(int i = 0; i < series; i++) {
+		double a = w[i];
+		sum[i] += a;
+		double* c = cross.Begin() + i * series;
+		for(int j = i; j < series; j++)
+			c[j] += a * w[j];
+	}
+	
+	if (++cursor == period) {cursor = 0; Renormalize();}
+}
+
+void CorrelationMatrix::Renormalize() {
+	for(int i = 0; i < series; i++) {
+		double mean = sum[i] / count;
+		shift[i] += mean;
+		sum[i] = 0;
+		for(int k = 0; k < count; k++)
+			win[k * series + i] -= mean;
+	}
+	for(double& d : cross) d = 0;
+	for(int k = 0; k < count; k++) {
+		const double* w = win.Begin() + k * series;
+		for(int i = 0; i < series; i++) {
+			double a = w[i];
+			sum[i] += a;
+			double* c = cross.Begin() + i * series;
+			for(int j = i; j < series; j++)
+				c[j] += a * w[j];
+		}
+	}
+}
+
+double CorrelationMatrix::Get(int a, int b) const {
+	if (count < 2)
+		return 0.0;
+	if (a > b) Swap(a, b);
+	return GetCorrelation(count, sum[a], sum[b], cross[a * series + b], cross[a * series + a], cross[b * series + b]);
+}
+
 int VectorBool::GetCount() const {
 	return count;
 }
@@ -100,6 +100,108 @@ public:
 	void Serialize(Stream& s) {s % win_a % win_b % sum_a % sum_b % period % cursor;}
 };
 
+// Pearson correlation of the last 'period' pairs from running sums. Values are kept relative
+// to a shift, and every time the window wraps the shift is moved to the window mean and the sums
+// are recomputed, so rounding error can't accumulate.
+class RollingCorrelation : Moveable<RollingCorrelation> {
+	Vector<double> win_a, win_b;
+	double shift_a = 0.0, shift_b = 0.0;
+	double sum_a = 0.0, sum_b = 0.0, sum_ab = 0.0, sum_aa = 0.0, sum_bb = 0.0;
+	int period = 0, cursor = 0, count = 0;
+	
+	void Renormalize();
+	
+public:
+	RollingCorrelation() {}
+	void SetPeriod(int i) {period = i; win_a.SetCount(i, 0); win_b.SetCount(i, 0); Clear();}
+	void Clear();
+	void Add(double a, double b) {
+		if (count == 0) {shift_a = a; shift_b = b;}
+		a -= shift_a;
+		b -= shift_b;
+		double& da = win_a[cursor];
+		double& db = win_b[cursor];
+		if (count == period) {
+			sum_a -= da;
+			sum_b -= db;
+			sum_ab -= da * db;
+			sum_aa -= da * da;
+			sum_bb -= db * db;
+		}
+		else count++;
+		da = a;
+		db = b;
+		sum_a += a;
+		sum_b += b;
+		sum_ab += a * b;
+		sum_aa += a * a;
+		sum_bb += b * b;
+		if (++cursor == period) {cursor = 0; Renormalize();}
+	}
+	double Get() const;
+	double GetMeanA() const {return count ? shift_a + sum_a / count : 0.0;}
+	double GetMeanB() const {return count ? shift_b + sum_b / count : 0.0;}
+	int GetCount() const {return count;}
+	void Serialize(Stream& s) {s % win_a % win_b % shift_a % shift_b % sum_a % sum_b % sum_ab % sum_aa % sum_bb % period % cursor % count;}
+};
+
+// Squared deviations of the last 'period' values from a given mean, from running sums of
+// values relative to a shift. The shift is moved to the window mean and the sums recomputed
+// every time the window wraps. Against a direct two-pass sum over the window the result
+// differs by rounding only; for price data the relative difference of the deviation stays
+// below 1e-11.
+class RollingDeviation : Moveable<RollingDeviation> {
+	Vector<double> win;
+	double shift = 0.0, sum = 0.0, sum_sq = 0.0;
+	int period = 0, cursor = 0, count = 0;
+	
+	void Renormalize();
+	
+public:
+	RollingDeviation() {}
+	void SetPeriod(int i) {period = i; win.SetCount(i, 0); Clear();}
+	void Clear() {shift = 0; sum = 0; sum_sq = 0; cursor = 0; count = 0;}
+	void Add(double v) {
+		if (count == 0) shift = v;
+		v -= shift;
+		double& d = win[cursor];
+		if (count == period) {
+			sum -= d;
+			sum_sq -= d * d;
+		}
+		else count++;
+		d = v;
+		sum += v;
+		sum_sq += v * v;
+		if (++cursor == period) {cursor = 0; Renormalize();}
+	}
+	double GetSumSquares(double mean) const {
+		double d = mean - shift;
+		return Upp::max(0.0, sum_sq - 2.0 * d * sum + count * d * d);
+	}
+	double GetStdDev(double mean) const {return period ? sqrt(GetSumSquares(mean) / period) : 0.0;}
+	int GetCount() const {return count;}
+};
+
+// Correlations between all pairs of 'series' aligned series over the last 'period' rows.
+// Adding a row is O(series^2), and uses the same re-centering as RollingCorrelation.
+class CorrelationMatrix : Moveable<CorrelationMatrix> {
+	Vector<double> win, shift, sum, cross;
+	int series = 0, period = 0, cursor = 0, count = 0;
+	
+	void Renormalize();
+	
+public:
+	CorrelationMatrix() {}
+	void SetSize(int series, int period);
+	void Clear();
+	void Add(const double* row);
+	double Get(int a, int b) const;
+	int GetSeries() const {return series;}
+	int GetCount() const {return count;}
+	void Serialize(Stream& s) {s % win % shift % sum % cross % series % period % cursor % count;}
+};
+
 struct OnlineAverage2 : Moveable<OnlineAverage2> {
 	double mean_a, mean_b;
 	int64 count;
@@ -459,32 +561,73 @@ class CoreIO;
 typedef const double ConstDouble;
 
 
+// Values of a buffer, which can be backed by a read-only mapped cache column.
+// The mapped column is copied to the owned vector only when it's modified, so pages of
+// unmodified values are faulted in by the OS only when they are read.
+// The mapping of the cache file is private, so only the written pages are copied. The values
+// grow to the spare capacity of the mapped column before they are copied to the vector.
+class BufferData : Moveable<BufferData> {
+	Vector<double> data;
+	double* mapped = NULL;
+	int mapped_count = 0, mapped_capacity = 0, mapped_stored = 0;
+	
+public:
+	BufferData() {}
+	
+	void Map(double* src, int count, int capacity) {data.Clear(); mapped = src; mapped_count = count; mapped_stored = count; mapped_capacity = capacity;}
+	void Realize();
+	void Prefetch(int begin, int end) const;
+	void Serialize(Stream& s) {if (s.IsStoring()) Realize(); else Clear(); s % data;}
+	
+	void SetCount(int i) {if (mapped && i <= mapped_capacity) {mapped_count = i; return;} Realize(); data.SetCount(i);}
+	void SetCount(int i, double d) {if (mapped && i <= mapped_capacity) {while (mapped_count < i) mapped[mapped_count++] = d; mapped_count = i; return;} Realize(); data.SetCount(i, d);}
+	void Reserve(int n) {if (!mapped) data.Reserve(n);}
+	void Clear() {data.Clear(); mapped = NULL; mapped_count = 0; mapped_capacity = 0; mapped_stored = 0;}
+	void Add(double d) {if (mapped && mapped_count < mapped_capacity) mapped[mapped_count++] = d; else {Realize(); data.Add(d);}}
+	Vector<double>& GetVector() {Realize(); return data;}
+	
+	int GetCount() const {return mapped ? mapped_count : data.GetCount();}
+	bool IsEmpty() const {return GetCount() == 0;}
+	bool IsMapped() const {return mapped;}
+	int64 GetMemoryUsage() const {return ((int64)data.GetAlloc() + (mapped ? max(0, mapped_count - mapped_stored) : 0)) * sizeof(double);}
+	
+	const double* Begin() const {return mapped ? mapped : data.Begin();}
+	const double* End() const {return Begin() + GetCount();}
+	double* Begin() {return mapped ? mapped : data.Begin();}
+	double* End() {return Begin() + GetCount();}
+	double operator[](int i) const {return Begin()[i];}
+	double& operator[](int i) {return Begin()[i];}
+};
+
+
 // Class for default visual settings for a single visible line of an indicator
 class Buffer : public Moveable<Buffer> {
 	
 public:
-	Vector<double> value;
+	BufferData value;
 	String label;
 	Color clr;
-	int style, line_style, line_width, chr, begin, shift, earliest_write;
+	int style, line_style, line_width, chr, begin, shift, earliest_write, unstored_write;
 	bool visible;
 	
 public:
-	Buffer() : clr(Black()), style(0), line_width(1), chr('^'), begin(0), shift(0), line_style(0), visible(true), earliest_write(INT_MAX) {}
+	Buffer() : clr(Black()), style(0), line_width(1), chr('^'), begin(0), shift(0), line_style(0), visible(true), earliest_write(INT_MAX), unstored_write(INT_MAX) {}
 	void Serialize(Stream& s) {s % value % label % clr % style % line_style % line_width % chr % begin % shift % visible;}
 	void SetCount(int i) {value.SetCount(i, 0.0);}
 	void Add(double d) {value.Add(d);}
 	void Reserve(int n) {value.Reserve(n);}
 	
-	int GetResetEarliestWrite() {int i = earliest_write; earliest_write = INT_MAX; return i;}
+	int GetResetEarliestWrite() {int i = Upp::min(earliest_write, unstored_write); earliest_write = INT_MAX; unstored_write = INT_MAX; return i;}
+	int TakeEarliestWrite() {int i = earliest_write; earliest_write = INT_MAX; if (i < unstored_write) unstored_write = i; return i;}
 	int GetCount() const {return value.GetCount();}
 	bool IsEmpty() const {return value.IsEmpty();}
 	double GetUnsafe(int i) const {return value[i];}
+	void Prefetch(int begin, int end) const {value.Prefetch(begin, end);}
 	
+	// Values are written only through BeginWrite, Set and Inc, which track the earliest write
 	ConstDouble* Begin() const {return value.Begin();}
 	ConstDouble* End()   const {return value.End();}
-	double* Begin() {return value.Begin();}
-	double* End()   {return value.End();}
+	double* BeginWrite(int begin) {if (begin < earliest_write) earliest_write = begin; return value.Begin();}
 	
 	// Some utility functions for checking that indicator values are strictly L-R
 	#ifdef flagDEBUG
@@ -496,7 +639,7 @@ public:
 	#else
 	double Get(int i) const {return value[i];}
 	void Set(int i, double value) {this->value[i] = value; if (i < earliest_write) earliest_write = i;}
-	void Inc(int i, double value) {this->value[i] += value;}
+	void Inc(int i, double value) {this->value[i] += value; if (i < earliest_write) earliest_write = i;}
 	#endif
 	
 	
@@ -769,13 +912,101 @@ inline int PopCount64(uint64 i) {
 	#endif
 }
 
+inline int LeadingZeros64(uint64 i) {
+	if (!i) return 64;
+	#ifdef flagMSC
+	unsigned long pos;
+	#if CPU_64
+	_BitScanReverse64(&pos, i);
+	return 63 - pos;
+	#elif CPU_32
+	if (i >> 32) {_BitScanReverse(&pos, (unsigned long)(i >> 32)); return 31 - pos;}
+	_BitScanReverse(&pos, (unsigned long)i);
+	return 63 - pos;
+	#endif
+	#else
+	return __builtin_clzll(i);
+	#endif
+}
+
+inline int TrailingZeros64(uint64 i) {
+	if (!i) return 64;
+	#ifdef flagMSC
+	unsigned long pos;
+	#if CPU_64
+	_BitScanForward64(&pos, i);
+	return pos;
+	#elif CPU_32
+	if ((dword)i) {_BitScanForward(&pos, (unsigned long)i); return pos;}
+	_BitScanForward(&pos, (unsigned long)(i >> 32));
+	return 32 + pos;
+	#endif
+	#else
+	return __builtin_ctzll(i);
+	#endif
+}
+
+
+// Rolling maximum (MAX=true) or minimum of the values added at the last 'size' positions.
+// Positions are absolute bar indices, which makes it easy to continue from 'counted':
+// re-add the 'size-1' positions before it and proceed. On equal values the newest wins.
+template <bool MAX>
+struct SlidingExtremum {
+	Vector<int> pos;
+	Vector<double> value;
+	int begin = 0, count = 0, size = 0;
+	
+	SlidingExtremum(int size=0) {SetSize(size);}
+	
+	void SetSize(int size) {
+		if (size == this->size) return;
+		this->size = size;
+		pos.SetCount(size);
+		value.SetCount(size);
+		Clear();
+	}
+	
+	void Clear() {begin = 0; count = 0;}
+	
+	void Serialize(Stream& s) {
+		s % pos % value % begin % count % size;
+	}
+	
+	void Add(int p, double v) {
+		ASSERT(size > 0);
+		while (count && pos[begin] <= p - size) {
+			if (++begin == size) begin = 0;
+			count--;
+		}
+		while (count) {
+			int back = begin + count - 1;
+			if (back >= size) back -= size;
+			if (MAX ? value[back] > v : value[back] < v)
+				break;
+			count--;
+		}
+		int back = begin + count;
+		if (back >= size) back -= size;
+		pos[back] = p;
+		value[back] = v;
+		count++;
+	}
+	
+	bool IsEmpty() const {return count == 0;}
+	int GetPos() const {ASSERT(count); return pos[begin];}
+	double Get() const {ASSERT(count); return value[begin];}
+};
+
+typedef SlidingExtremum<true>	SlidingMax;
+typedef SlidingExtremum<false>	SlidingMin;
+
 
 // Reduce complexity: e.g. for zigzag
 
 struct ExtremumCache {
-	Vector<double> max, min;
-	double max_value = -DBL_MAX, min_value = DBL_MAX;
-	int pos = -1, size = 0, max_left = 0, min_left = 0;
+	SlidingMax max;
+	SlidingMin min;
+	int pos = -1, size = 0;
 	
 	ExtremumCache(int size=0) {
 		SetSize(size);
@@ -783,61 +1014,66 @@ struct ExtremumCache {
 	
 	void SetSize(int size) {
 		this->size = size;
-		max.SetCount(size, -DBL_MAX);
-		min.SetCount(size, DBL_MAX);
+		max.SetSize(size);
+		min.SetSize(size);
 	}
 	
 	void Serialize(Stream& s) {
-		s % max % min % max_value % min_value % pos % size % max_left % min_left;
+		s % max % min % pos % size;
 	}
 	
 	void Add(double low, double high) {
 		pos++;
-		int write_pos = pos % size;
-		
-		max_left--;
-		max[write_pos] = high;
-		if (max_left <= 0) {
-			max_value = -DBL_MAX;
-			for(int i = 0; i < size; i++) {
-				double d = max[i];
-				if (d > max_value) {
-					if (i <= write_pos)	max_left = size - (write_pos - i);
-					else				max_left = i - write_pos;
-					max_value = d;
-				}
-			}
-		}
-		else if (high >= max_value) {
-			max_left = size;
-			max_value = high;
-		}
-		
-		min_left--;
-		min[write_pos] = low;
-		if (min_left <= 0) {
-			min_value = DBL_MAX;
-			for(int i = 0; i < size; i++) {
-				double d = min[i];
-				if (d < min_value) {
-					if (i <= write_pos)	min_left = size - (write_pos - i);
-					else				min_left = i - write_pos;
-					min_value = d;
-				}
-			}
-		}
-		else if (low <= min_value) {
-			min_left = size;
-			min_value = low;
-		}
+		max.Add(pos, high);
+		min.Add(pos, low);
+	}
+	
+	int GetHighest() const {
+		return max.GetPos();
 	}
 	
-	int GetHighest() {
-		return pos - (size - max_left);
+	int GetLowest() const {
+		return min.GetPos();
+	}
+};
+
+// Counts how many of the added [low, high] level ranges intersect a level interval.
+// Two Fenwick trees over the range ends make adding, removing and querying O(log levels):
+// the ranges intersecting [begin, end] are those with low <= end minus those with high < begin.
+struct RangeHistogram {
+	Vector<int> lows, highs;
+	int count = 0;
+	
+	void SetLevels(int levels) {
+		lows.SetCount(0);
+		highs.SetCount(0);
+		lows.SetCount(levels, 0);
+		highs.SetCount(levels, 0);
+		count = 0;
+	}
+	
+	int GetLevels() const {return lows.GetCount();}
+	int GetCount() const {return count;}
+	
+	void Add(int low, int high)		{Update(lows, low, +1); Update(highs, high, +1); count++;}
+	void Remove(int low, int high)	{Update(lows, low, -1); Update(highs, high, -1); count--;}
+	
+	int Get(int begin, int end) const {return Prefix(lows, end) - Prefix(highs, begin - 1);}
+	int Get(int level) const {return Get(level, level);}
+	
+private:
+	static void Update(Vector<int>& tree, int i, int d) {
+		ASSERT(i >= 0 && i < tree.GetCount());
+		int n = tree.GetCount();
+		for (i++; i <= n; i += i & -i)
+			tree[i-1] += d;
 	}
 	
-	int GetLowest() {
-		return pos - (size - min_left);
+	static int Prefix(const Vector<int>& tree, int i) {
+		int sum = 0;
+		for (i = Upp::min(i, tree.GetCount() - 1) + 1; i > 0; i -= i & -i)
+			sum += tree[i-1];
+		return sum;
 	}
 };
 
@@ -17,6 +17,7 @@ void Buffer::Set(int i, double value) {
 void Buffer::Inc(int i, double value) {
 	if (check_cio) check_cio->SafetyInspect(i);
 	this->value[i] += value;
+	if (i < earliest_write) earliest_write = i;
 }
 #endif
 
@@ -33,11 +34,14 @@ Core::Core()
 	minimum = 0;
 	skip_setcount = false;
 	skip_allocate = false;
+	allow_rewind = false;
 	point = 0.01;
 	period = 0;
 	end_offset = 0;
 	future_bars = 0;
 	db_src = -1;
+	for(int i = 0; i < 4; i++)
+		bar_buffers[i] = NULL;
 }
 
 Core::~Core() {
@@ -62,6 +66,9 @@ Core& Core::Set(String key, Value value) {
 void Core::ClearContent() {
 	bars = 0;
 	counted = 0;
+	assist_count = 0;
+	for(int i = 0; i < assist_columns.GetCount(); i++)
+		assist_columns[i].SetCount(0);
 	for(int i = 0; i < buffers.GetCount(); i++) {
 		buffers[i]->value.Clear();
 	}
@@ -90,8 +97,9 @@ void Core::InitAll() {
 			break;
 		}
 	}
-		
-		
+	BindInputs();
+	
+	
 	// Clear values what can be added in the Init
 	subcores.Clear();
 	subcore_factories.Clear();
@@ -101,6 +109,17 @@ void Core::InitAll() {
 	Init();
 	
 	
+	// One precomputed column for every assist type of the factory
+	assist_types.Clear();
+	int assist_pos = System::AssistantFactories().Find(factory);
+	if (assist_pos >= 0) {
+		const VectorMap<int, String>& types = System::AssistantFactories()[assist_pos];
+		for(int i = 0; i < types.GetCount(); i++)
+			assist_types.Add(types.GetKey(i));
+	}
+	assist_columns.SetCount(assist_types.GetCount());
+	
+	
 	// Register jobs
 	JobThread& thrd = sys.GetJobThread(sym_id, tf_id);
 	WRITELOCK(thrd.job_lock) {
@@ -172,19 +191,109 @@ void Core::RefreshSources() {
 }
 
 void Core::RefreshSourcesOnlyDeep() {
+	Index<Core*> visited;
+	Vector<Core*> order;
+	GetSourcesDeep(visited, order);
+	
+	// DataBridges write the shared time axis, which other queue workers are reading
+	int db_factory = System::IsQueueWorker() ? System::Find<DataBridge>() : -1;
+	for(int i = 0; i < order.GetCount(); i++)
+		if (order[i]->GetFactory() != db_factory)
+			order[i]->Refresh();
+}
+
+void Core::GetSourcesDeep(Index<Core*>& visited, Vector<Core*>& order) {
 	for(int i = 0; i < inputs.GetCount(); i++) {
 		Input& in = inputs[i];
 		for(int j = 0; j < in.GetCount(); j++) {
-			Source& src = in[j];
-			if (src.core) {
-				Core* core = dynamic_cast<Core*>(src.core);
-				if (core) {
-					core->RefreshSourcesOnlyDeep();
-					core->Refresh();
-				}
+			Core* core = dynamic_cast<Core*>(in[j].core);
+			if (!core || core == this || visited.Find(core) != -1)
+				continue;
+			visited.Add(core);
+			core->GetSourcesDeep(visited, order);
+			order.Add(core);
+		}
+	}
+}
+
+int Core::GetDirtyBegin() {
+	int begin = INT_MAX;
+	
+	// DataBridges poll new data and jobs may change their cores at any time
+	if (!counted || factory == 0 || !jobs.IsEmpty())
+		begin = counted;
+	
+	// New bars in the time axis
+	if (!skip_setcount && GetSystem().GetCountTf(sym_id, tf_id) + end_offset != bars)
+		begin = min(begin, counted);
+	
+	// Changed sources and sub-cores
+	int k = 0;
+	for(int i = 0; i < inputs.GetCount() + 1; i++) {
+		int src_count = i < inputs.GetCount() ? inputs[i].GetCount() : subcores.GetCount();
+		for(int j = 0; j < src_count; j++, k++) {
+			CoreIO* src;
+			bool same_axis;
+			if (i < inputs.GetCount()) {
+				const Source& s = inputs[i][j];
+				src = s.core;
+				same_axis = s.sym == sym_id && s.tf == tf_id;
+			} else {
+				src = &subcores[j];
+				same_axis = true;
 			}
+			if (k >= source_epochs.GetCount()) {
+				source_epochs.Add(-1);
+				source_counts.Add(0);
+			}
+			if (!src || src == this)
+				continue;
+			
+			int64 epoch = src->GetChangeEpoch();
+			if (epoch == source_epochs[k])
+				continue;
+			
+			// Rewritten bars can be mapped only to the same time axis
+			if (source_epochs[k] == -1 || !same_axis)
+				begin = min(begin, counted);
+			else
+				begin = min(begin, src->GetChangeBegin(source_epochs[k], source_counts[k]));
+			
+			source_epochs[k] = epoch;
+			source_counts[k] = src->GetChangeCount();
 		}
 	}
+	
+	return begin;
+}
+
+void Core::RefreshChangeEpoch() {
+	int count = 0;
+	int begin = INT_MAX;
+	for(int i = 0; i < buffers.GetCount(); i++) {
+		Buffer& buf = *buffers[i];
+		count = max(count, buf.GetCount());
+		begin = min(begin, buf.TakeEarliestWrite());
+	}
+	if (count != change_count)
+		begin = min(begin, min(count, change_count));
+	
+	// Cores without buffers can't tell what they changed
+	if (buffers.IsEmpty())
+		begin = 0;
+	
+	if (begin == INT_MAX)
+		return;
+	
+	change_epoch++;
+	if (begin < change_count - 1) {
+		rewrites.Add(Tuple2<int64, int>(change_epoch, begin));
+		if (rewrites.GetCount() > 16) {
+			rewrite_floor_epoch = rewrites[0].a;
+			rewrites.Remove(0);
+		}
+	}
+	change_count = count;
 }
 
 void Core::Refresh() {
@@ -194,6 +303,25 @@ void Core::Refresh() {
 		subcores[i].Refresh();
 	
 	
+	// Skip cores without new or changed input data
+	int dirty_begin = GetDirtyBegin();
+	if (dirty_begin == INT_MAX) {
+		refresh_lock.Leave();
+		return;
+	}
+	
+	// Recompute older bars, which were rewritten in sources. Cores with private state between
+	// refreshes are computed again from the beginning, unless they allow rewinding.
+	if (dirty_begin < counted - 1) {
+		if (allow_rewind)
+			counted = dirty_begin;
+		else
+			ClearContent();
+	}
+	int assist_begin = counted - 1;
+	
+	PinSources();
+	
 	
 	// Some indicators might want to set the size by themselves
 	if (!skip_setcount) {
@@ -204,6 +332,8 @@ void Core::Refresh() {
 			int reserve = count + 512;
 			reserve -= reserve % 512;
 			for(int i = 0; i < buffers.GetCount(); i++) {
+				if (buffers[i]->value.GetCount() == count)
+					continue;
 				buffers[i]->value.Reserve(reserve);
 				buffers[i]->value.SetCount(count, 0);
 			}
@@ -214,6 +344,11 @@ void Core::Refresh() {
 	
 	counted = next_count;
 	
+	RefreshAssist(assist_begin);
+	
+	RefreshChangeEpoch();
+	
+	UnpinSources();
 	refresh_lock.Leave();
 	
 }
@@ -234,34 +369,27 @@ BarData* Core::GetBarData() {
 	return Get<BarData>();
 }
 
-double Core::Open ( int shift ) {
-	SAFETYASSERT(shift <= read_safety_limit);
-	return GetInputBuffer(db_src, GetSymbol(), GetTimeframe(), 0).Get(shift);
-}
-
-double Core::Low( int shift ) {
-	SAFETYASSERT(shift < read_safety_limit);
-	return GetInputBuffer(db_src, GetSymbol(), GetTimeframe(), 1).Get(shift);
-}
-
-double Core::High( int shift ) {
-	SAFETYASSERT(shift < read_safety_limit);
-	return GetInputBuffer(db_src, GetSymbol(), GetTimeframe(), 2).Get(shift);
-}
-
-double Core::Volume ( int shift ) {
-	SAFETYASSERT(shift <= read_safety_limit);
-	return GetInputBuffer(db_src, GetSymbol(), GetTimeframe(), 3).Get(shift);
+void Core::BindInputs() {
+	int key = HashSymTf(sym_id, tf_id);
+	input_outputs.SetCount(inputs.GetCount());
+	for(int i = 0; i < inputs.GetCount(); i++) {
+		int pos = inputs[i].Find(key);
+		input_outputs[i] = pos >= 0 ? inputs[i][pos].output : NULL;
+	}
+	
+	const Output* bars = db_src >= 0 ? input_outputs[db_src] : NULL;
+	for(int i = 0; i < 4; i++)
+		bar_buffers[i] = bars && i < bars->buffers.GetCount() ? &bars->buffers[i] : NULL;
 }
 
 int Core::HighestHigh(int period, int shift) {
 	ASSERT(period > 0);
+	ConstDouble* high = HighBegin();
 	double highest = -DBL_MAX;
 	int highest_pos = -1;
 	for (int i = 0; i < period && shift >= 0; i++, shift--) {
-		double high = High(shift);
-		if (high > highest) {
-			highest = high;
+		if (high[shift] > highest) {
+			highest = high[shift];
 			highest_pos = shift;
 		}
 	}
@@ -270,12 +398,12 @@ int Core::HighestHigh(int period, int shift) {
 
 int Core::LowestLow(int period, int shift) {
 	ASSERT(period > 0);
+	ConstDouble* low = LowBegin();
 	double lowest = DBL_MAX;
 	int lowest_pos = -1;
 	for (int i = 0; i < period && shift >= 0; i++, shift--) {
-		double low = Low(shift);
-		if (low < lowest) {
-			lowest = low;
+		if (low[shift] < lowest) {
+			lowest = low[shift];
 			lowest_pos = shift;
 		}
 	}
@@ -284,12 +412,12 @@ int Core::LowestLow(int period, int shift) {
 
 int Core::HighestOpen(int period, int shift) {
 	ASSERT(period > 0);
+	ConstDouble* open = OpenBegin();
 	double highest = -DBL_MAX;
 	int highest_pos = -1;
 	for (int i = 0; i < period && shift >= 0; i++, shift--) {
-		double open = Open(shift);
-		if (open > highest) {
-			highest = open;
+		if (open[shift] > highest) {
+			highest = open[shift];
 			highest_pos = shift;
 		}
 	}
@@ -298,12 +426,12 @@ int Core::HighestOpen(int period, int shift) {
 
 int Core::LowestOpen(int period, int shift) {
 	ASSERT(period > 0);
+	ConstDouble* open = OpenBegin();
 	double lowest = DBL_MAX;
 	int lowest_pos = -1;
 	for (int i = 0; i < period && shift >= 0; i++, shift--) {
-		double open = Open(shift);
-		if (open < lowest) {
-			lowest = open;
+		if (open[shift] < lowest) {
+			lowest = open[shift];
 			lowest_pos = shift;
 		}
 	}
@@ -319,6 +447,14 @@ int Core::GetPeriod() const {
 	return period;
 }
 
+int Core::FindShift(Time t, bool exact) const {
+	return GetSystem().FindShiftTf(sym_id, tf_id, t, exact);
+}
+
+bool Core::GetShiftRange(Time begin, Time end, int& first, int& last) const {
+	return GetSystem().GetShiftRangeTf(sym_id, tf_id, begin, end, first, last);
+}
+
 void Core::SetTimeframe(int i, int period) {
 	CoreIO::SetTimeframe(i);
 	this->period = period;
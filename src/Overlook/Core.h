@@ -143,11 +143,22 @@ protected:
 	Vector<Buffer*> buffers;
 	Array<Job> jobs;
 	Array<Persistent> persistents;
+	One<CoreCacheReader> cache_reader;
+	Array<CoreCacheReader> retired_readers;
 	Job* current_job = NULL;
 	JobThread* current_thrd = NULL;
 	SpinLock serialization_lock, refresh_lock;
+	Mutex pin_lock;
+	int pin_count = 0;
+	Vector<Tuple2<int64, int> > rewrites;
+	Vector<VectorBool> assist_columns;
+	Vector<int> assist_types;
+	int64 change_epoch = 0, rewrite_floor_epoch = -1;
+	int assist_count = 0, assist_write = INT_MAX;
 	int sym_id, tf_id, factory, hash;
 	int counted, bars;
+	int change_count = 0;
+	int last_access = 0;
 	int db_src;
 	bool serialized;
 	bool is_init = false;
@@ -175,14 +186,40 @@ public:
 	CoreIO();
 	virtual ~CoreIO();
 	
-	void StoreCache();
+	// State of a cache file, which is set when the whole file has been read. Persistent
+	// variables are read in place, so their previous values are kept for restoring them.
+	struct CacheState {
+		Array<Job> jobs;
+		Vector<VectorBool> labels, assist_columns;
+		String persistents;
+		int counted = 0, bars = 0, assist_count = 0;
+		bool restore = false;
+	};
+	
+	bool StoreCache();
 	void LoadCache();
-	void Put(Stream& out, const String& dir, int subcore_id);
-	void Get(Stream& in, const String& dir, int subcore_id);
+	void Put(Stream& out, int subcore_id);
+	bool Get(Stream& in, int subcore_id, CacheState& state);
+	void SetCacheState(CacheState& state);
+	void RestoreCacheState(CacheState& state);
+	void GetCacheColumns(Vector<Buffer*>& columns);
+	void GetCacheCores(Vector<CoreIO*>& cores);
+	int  GetCacheColumnCount();
+	void RealizeCache();
+	bool MapCache();
+	bool ReleaseMemory();
+	void Pin();
+	void Unpin();
+	void PinSources();
+	void UnpinSources();
+	int64 GetMemoryUsage();
+	void Prefetch(int begin, int end);
 	
 	virtual void IO(const ValueBase& base);
 	virtual void Assist(int cursor, VectorBool& vec) {}
 	void RefreshBuffers();
+	void RefreshAssist(int begin);
+	void GetAssist(int cursor, VectorBool& vec);
 	
 	template <class T> T* Get() {
 		T* t = dynamic_cast<T*>(this);
@@ -211,10 +248,10 @@ public:
 	Output& GetOutput(int output) {return outputs[output];}
 	ConstOutput& GetOutput(int output) const {return outputs[output];}
 	const CoreIO& GetInput(int input, int sym, int tf) const;
-	String GetCacheDirectory();
+	String GetCacheFile();
 	Color GetBufferColor(int i) {return buffers[i]->clr;}
-	double GetBufferValue(int i, int shift) {return buffers[i]->value[shift];}
-	double GetBufferValue(int shift) {return outputs[0].buffers[0].value[shift];}
+	double GetBufferValue(int i, int shift) {return buffers[i]->GetUnsafe(shift);}
+	double GetBufferValue(int shift) {return outputs[0].buffers[0].GetUnsafe(shift);}
 	int GetBufferStyle(int i) {return buffers[i]->style;}
 	int GetBufferArrow(int i) {return buffers[i]->chr;}
 	int GetBufferLineWidth(int i) {return buffers[i]->line_width;}
@@ -222,6 +259,11 @@ public:
 	int GetBufferCount() {return buffers.GetCount();}
 	int GetOutputCount() const {return outputs.GetCount();}
 	int GetFactory() const {return factory;}
+	int64 GetChangeEpoch() const {return change_epoch;}
+	int GetChangeCount() const {return change_count;}
+	int GetLastAccess() const {return last_access;}
+	void SetLastAccess(int i) {last_access = i;}
+	int GetChangeBegin(int64 seen_epoch, int seen_count);
 	bool IsInitialized() const {return is_init;}
 	
 	void SetInput(int input_id, int sym_id, int tf_id, CoreIO& core, int output_id);
@@ -264,6 +306,10 @@ protected:
 	// Visual settings
 	Array<Core> subcores;
 	Vector<int> subcore_factories;
+	Vector<int64> source_epochs;
+	Vector<int> source_counts;
+	Vector<const Output*> input_outputs;
+	const Buffer* bar_buffers[4];
 	Vector<DataLevel> levels;
 	Color levels_clr;
 	double minimum, maximum;
@@ -277,6 +323,7 @@ protected:
 	bool has_maximum, has_minimum;
 	bool skip_setcount;
 	bool skip_allocate;
+	bool allow_rewind;
 	
 	Core();
 	
@@ -323,9 +370,16 @@ public:
 	int GetTf() const {return tf_id;}
 	int GetSymbol() const {return sym_id;}
 	int GetPeriod() const;
+	int FindShift(Time t, bool exact=false) const;
+	bool GetShiftRange(Time begin, Time end, int& first, int& last) const;
 	int GetVisibleCount() const {return outputs[0].visible;}
 	int GetFutureBars() const {return future_bars;}
-	inline ConstBuffer& GetInputBuffer(int input, int buffer) const {return CoreIO::GetInputBuffer(input, GetSymbol(), GetTimeframe(), buffer);}
+	inline ConstBuffer& GetInputBuffer(int input, int buffer) const {
+		const Output* out = input < input_outputs.GetCount() ? input_outputs[input] : NULL;
+		if (!out) return CoreIO::GetInputBuffer(input, GetSymbol(), GetTimeframe(), buffer);
+		if (buffer < 0) buffer += out->buffers.GetCount();
+		return SafetyBuffer(out->buffers[buffer]);
+	}
 	inline ConstBuffer& GetInputBuffer(int input, int sym, int tf, int buffer) const {return CoreIO::GetInputBuffer(input, sym, tf, buffer);}
 	inline ConstVectorBool& GetInputLabel(int input) const {return CoreIO::GetInputLabel(input, GetSymbol(), GetTimeframe());}
 	BarData* GetBarData();
@@ -353,29 +407,43 @@ public:
 	void SetBufferLabel(int i, const String& s) {}
 	void SetEndOffset(int i) {ASSERT(i > 0); end_offset = i;}
 	void SetSkipAllocate(bool b=true) {skip_allocate = b;}
+	void SetAllowRewind(bool b=true) {allow_rewind = b;}
 	void SetFutureBars(int i) {future_bars = i;}
 	Job& SetJob(int i, String job_title);
 	Job& GetJob(int i);
 	void SetJobFinished(bool b=true);
 	void SetJobCount(int i) {jobs.SetCount(i);}
-	void EnterJob(Job* job, JobThread* thrd) {current_job = job; current_thrd = thrd;}
-	void LeaveJob() {current_job = NULL; current_thrd = NULL;}
+	void EnterJob(Job* job, JobThread* thrd) {Pin(); PinSources(); current_job = job; current_thrd = thrd;}
+	void LeaveJob() {current_job = NULL; current_thrd = NULL; UnpinSources(); Unpin();}
 	
 	// Visible main functions
 	void Refresh();
 	void RefreshSources();
 	void RefreshSourcesOnlyDeep();
+	void GetSourcesDeep(Index<Core*>& visited, Vector<Core*>& order);
 	void ClearContent();
 	void RefreshIO() {IO(*this);}
 	
 protected:
 	
+	int GetDirtyBegin();
+	void RefreshChangeEpoch();
+	void BindInputs();
+	
 	// Value data functions
 	double GetAppliedValue ( int applied_value, int i );
-	double Open(int shift);
-	double High(int shift);
-	double Low(int shift);
-	double Volume(int shift);
+	double Open(int shift) const   {SAFETYASSERT(shift <= read_safety_limit); return bar_buffers[0]->GetUnsafe(shift);}
+	double Low(int shift) const    {SAFETYASSERT(shift < read_safety_limit);  return bar_buffers[1]->GetUnsafe(shift);}
+	double High(int shift) const   {SAFETYASSERT(shift < read_safety_limit);  return bar_buffers[2]->GetUnsafe(shift);}
+	double Volume(int shift) const {SAFETYASSERT(shift <= read_safety_limit); return bar_buffers[3]->GetUnsafe(shift);}
+	
+	// Raw values of the DataBridge input. Pointers are valid until the source is refreshed again.
+	ConstDouble* OpenBegin() const   {return bar_buffers[0]->Begin();}
+	ConstDouble* LowBegin() const    {return bar_buffers[1]->Begin();}
+	ConstDouble* HighBegin() const   {return bar_buffers[2]->Begin();}
+	ConstDouble* VolumeBegin() const {return bar_buffers[3]->Begin();}
+	int GetBarCount() const          {return bar_buffers[0]->GetCount();}
+	
 	int HighestHigh(int period, int shift);
 	int LowestLow(int period, int shift);
 	int HighestOpen(int period, int shift);
@@ -0,0 +1,527 @@
+#include "Overlook.h"
+
+#ifdef PLATFORM_POSIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+namespace Overlook {
+
+struct BitWriter {
+	Vector<byte>& out;
+	uint64 acc = 0;
+	int acc_bits = 0;
+	
+	BitWriter(Vector<byte>& out) : out(out) {}
+	
+	void Put(uint64 value, int bits) {
+		ASSERT(bits > 0 && bits <= 32);
+		acc = (acc << bits) | (value & ((1ULL << bits) - 1));
+		acc_bits += bits;
+		while (acc_bits >= 8) {
+			acc_bits -= 8;
+			out.Add((byte)(acc >> acc_bits));
+		}
+	}
+	void Put64(uint64 value, int bits) {
+		if (bits > 32) {
+			Put(value >> 32, bits - 32);
+			bits = 32;
+		}
+		Put(value, bits);
+	}
+	void Flush() {
+		if (acc_bits)
+			out.Add((byte)(acc << (8 - acc_bits)));
+		acc_bits = 0;
+	}
+};
+
+struct BitReader {
+	const byte* cur;
+	const byte* end;
+	uint64 acc = 0;
+	int acc_bits = 0;
+	
+	BitReader(const byte* src, int size) : cur(src), end(src + size) {}
+	
+	bool Get(int bits, uint64& value) {
+		ASSERT(bits > 0 && bits <= 32);
+		while (acc_bits < bits) {
+			if (cur >= end)
+				return false;
+			acc = (acc << 8) | *cur++;
+			acc_bits += 8;
+		}
+		acc_bits -= bits;
+		value = (acc >> acc_bits) & ((1ULL << bits) - 1);
+		return true;
+	}
+	bool Get64(int bits, uint64& value) {
+		uint64 hi = 0, lo;
+		if (bits > 32) {
+			if (!Get(bits - 32, hi))
+				return false;
+			bits = 32;
+		}
+		if (!Get(bits, lo))
+			return false;
+		value = (hi << 32) | lo;
+		return true;
+	}
+};
+
+void XorEncode(const double* src, int count, Vector<byte>& out) {
+	out.SetCount(0);
+	if (count <= 0)
+		return;
+	BitWriter w(out);
+	uint64 prev;
+	memcpy(&prev, src, sizeof(double));
+	w.Put64(prev, 64);
+	int prev_lead = -1, prev_trail = 0;
+	for(int i = 1; i < count; i++) {
+		uint64 cur;
+		memcpy(&cur, src + i, sizeof(double));
+		uint64 x = cur ^ prev;
+		prev = cur;
+		
+		// Same value
+		if (!x) {
+			w.Put(0, 1);
+			continue;
+		}
+		
+		// Meaningful bits fit in the previous window
+		int lead = min(LeadingZeros64(x), 31);
+		int trail = TrailingZeros64(x);
+		if (prev_lead >= 0 && lead >= prev_lead && trail >= prev_trail) {
+			w.Put(2, 2);
+			w.Put64(x >> prev_trail, 64 - prev_lead - prev_trail);
+		}
+		
+		// New window
+		else {
+			int len = 64 - lead - trail;
+			w.Put(3, 2);
+			w.Put(lead, 5);
+			w.Put(len - 1, 6);
+			w.Put64(x >> trail, len);
+			prev_lead = lead;
+			prev_trail = trail;
+		}
+	}
+	w.Flush();
+}
+
+bool XorDecode(const byte* src, int size, double* dst, int count) {
+	if (count <= 0)
+		return true;
+	BitReader r(src, size);
+	uint64 prev, bit;
+	if (!r.Get64(64, prev))
+		return false;
+	memcpy(dst, &prev, sizeof(double));
+	int lead = 0, trail = 0;
+	for(int i = 1; i < count; i++) {
+		if (!r.Get(1, bit))
+			return false;
+		if (bit) {
+			if (!r.Get(1, bit))
+				return false;
+			if (bit) {
+				uint64 l, len;
+				if (!r.Get(5, l) || !r.Get(6, len))
+					return false;
+				lead = (int)l;
+				trail = 64 - lead - (int)len - 1;
+				if (trail < 0)
+					return false;
+			}
+			uint64 x;
+			if (!r.Get64(64 - lead - trail, x))
+				return false;
+			prev ^= x << trail;
+		}
+		memcpy(dst + i, &prev, sizeof(double));
+	}
+	return true;
+}
+
+
+
+
+// The file is replaced atomically, so that its readers keep the old mapping
+static bool MoveCacheFile(const String& src, const String& dst) {
+	#ifdef PLATFORM_WIN32
+	if (MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING))
+		return true;
+	
+	// Mapped files can be renamed but not replaced
+	String old = dst + ".old";
+	DeleteFileA(old);
+	return MoveFileExA(dst, old, MOVEFILE_REPLACE_EXISTING) && MoveFileExA(src, dst, 0);
+	#else
+	return rename(src, dst) == 0;
+	#endif
+}
+
+dword CoreCacheChecksum(const CoreCacheHeader& header, const CoreCacheColumn* columns) {
+	CoreCacheHeader h = header;
+	h.checksum = 0;
+	CombineHash ch;
+	ch << memhash(&h, sizeof(CoreCacheHeader)) << memhash(columns, h.column_count * sizeof(CoreCacheColumn));
+	return ch;
+}
+
+bool CoreCacheWriter::Open(const String& path, int column_count, bool recreate) {
+	this->path = path;
+	tmp_path.Clear();
+	
+	// Continue existing file
+	if (!recreate && FileExists(path) && file.Open(path, FileStream::READWRITE)) {
+		if (ReadHeader(column_count))
+			return true;
+		file.Close();
+	}
+	
+	// New file is written beside the old one, which might be mapped, and it replaces the old
+	// one in Close
+	tmp_path = path + ".tmp";
+	if (!file.Open(tmp_path, FileStream::CREATE))
+		return false;
+	memset(&header, 0, sizeof(CoreCacheHeader));
+	header.magic = CORECACHE_MAGIC;
+	header.version = CORECACHE_VERSION;
+	header.column_count = column_count;
+	header.file_end = 2 * CoreCacheHeaderSize(column_count);
+	columns.SetCount(column_count);
+	if (column_count)
+		memset(columns.Begin(), 0, column_count * sizeof(CoreCacheColumn));
+	Grow();
+	return true;
+}
+
+bool CoreCacheWriter::ReadHeader(int column_count) {
+	int64 slot_size = CoreCacheHeaderSize(column_count);
+	CoreCacheHeader h;
+	Vector<CoreCacheColumn> cols;
+	cols.SetCount(column_count);
+	bool found = false;
+	for(int i = 0; i < 2; i++) {
+		file.Seek(i * slot_size);
+		if (!file.GetAll(&h, sizeof(CoreCacheHeader)) ||
+			h.magic != CORECACHE_MAGIC ||
+			h.version != CORECACHE_VERSION ||
+			h.column_count != column_count ||
+			(column_count && !file.GetAll(cols.Begin(), column_count * sizeof(CoreCacheColumn))) ||
+			h.checksum != CoreCacheChecksum(h, cols.Begin()) ||
+			(found && h.serial <= header.serial))
+			continue;
+		header = h;
+		columns <<= cols;
+		found = true;
+	}
+	file.ClearError();
+	return found;
+}
+
+// The file is grown by writing, because mapped files can't be resized on every platform
+void CoreCacheWriter::Grow() {
+	if (file.GetSize() < header.file_end) {
+		file.Seek(header.file_end - 1);
+		file.Put(0);
+	}
+}
+
+int64 CoreCacheWriter::Allocate(int64 size, int64 align) {
+	int64 offset = CoreCacheAlign(header.file_end, align);
+	header.file_end = offset + CoreCacheAlign(size, align);
+	Grow();
+	return offset;
+}
+
+// The current header points to the previous metadata, so it's not overwritten
+void CoreCacheWriter::SetMeta(const String& meta) {
+	header.garbage += header.meta_capacity;
+	header.meta_capacity = CoreCachePageAlign(max(meta.GetCount(), 1));
+	header.meta_offset = Allocate(header.meta_capacity);
+	file.Seek(header.meta_offset);
+	file.Put(meta.Begin(), meta.GetCount());
+	header.meta_size = meta.GetCount();
+}
+
+void CoreCacheWriter::SetColumn(int i, const double* data, int count, int begin, int codec) {
+	CoreCacheColumn& col = columns[i];
+	
+	// Changed codec requires to write everything again
+	if (col.codec != codec) {
+		header.garbage += col.capacity;
+		col.offset = 0;
+		col.capacity = 0;
+		col.count = 0;
+		col.codec = codec;
+	}
+	
+	// Values after the previously stored count are always new
+	begin = max(0, min(begin, col.count));
+	
+	if (codec == CORECACHE_XOR)
+		SetXorColumn(col, data, count, begin);
+	else
+		SetRawColumn(col, data, count, begin);
+	
+	col.count = count;
+}
+
+void CoreCacheWriter::SetRawColumn(CoreCacheColumn& col, const double* data, int count, int begin) {
+	
+	// Move growing column to the end of the file with some room for new bars
+	int64 size = count * sizeof(double);
+	if (size > col.capacity) {
+		header.garbage += col.capacity;
+		col.capacity = CoreCachePageAlign((count + count / 8 + 512) * sizeof(double));
+		col.offset = Allocate(col.capacity);
+		begin = 0;
+	}
+	
+	if (begin < count) {
+		file.Seek(col.offset + begin * sizeof(double));
+		file.Put(data + begin, (count - begin) * sizeof(double));
+	}
+}
+
+void CoreCacheWriter::SetXorColumn(CoreCacheColumn& col, const double* data, int count, int begin) {
+	CoreCacheChunkTable table;
+	table.zero_prefix = 0;
+	table.chunk_count = 0;
+	Vector<CoreCacheChunk> chunks;
+	
+	// Read the previous chunk table
+	if (col.offset) {
+		file.Seek(col.offset);
+		if (file.GetAll(&table, sizeof(CoreCacheChunkTable))) {
+			chunks.SetCount(table.chunk_count);
+			if (table.chunk_count && !file.GetAll(chunks.Begin(), table.chunk_count * sizeof(CoreCacheChunk)))
+				begin = 0;
+		}
+		else begin = 0;
+	}
+	
+	// Changes in the zero prefix requires to encode everything again
+	if (begin < table.zero_prefix || begin == 0 || count < table.zero_prefix) {
+		for(int i = 0; i < chunks.GetCount(); i++)
+			header.garbage += chunks[i].capacity;
+		chunks.Clear();
+		table.zero_prefix = 0;
+		while (table.zero_prefix < count) {
+			uint64 bits;
+			memcpy(&bits, data + table.zero_prefix, sizeof(double));
+			if (bits) break;
+			table.zero_prefix++;
+		}
+		begin = table.zero_prefix;
+	}
+	
+	// Encode changed chunks and reuse their old space when possible
+	int chunk_count = (count - table.zero_prefix + CORECACHE_CHUNK - 1) / CORECACHE_CHUNK;
+	while (chunks.GetCount() > chunk_count) {
+		header.garbage += chunks.Top().capacity;
+		chunks.Pop();
+	}
+	for(int i = (begin - table.zero_prefix) / CORECACHE_CHUNK; i < chunk_count; i++) {
+		int chunk_begin = table.zero_prefix + i * CORECACHE_CHUNK;
+		int chunk_size = min((int)CORECACHE_CHUNK, count - chunk_begin);
+		XorEncode(data + chunk_begin, chunk_size, tmp);
+		
+		if (i >= chunks.GetCount()) {
+			CoreCacheChunk& c = chunks.Add();
+			c.offset = 0;
+			c.capacity = 0;
+		}
+		CoreCacheChunk& c = chunks[i];
+		if (tmp.GetCount() > c.capacity) {
+			header.garbage += c.capacity;
+			c.capacity = (int)CoreCacheAlign(tmp.GetCount() + tmp.GetCount() / 4 + 64, 8);
+			c.offset = Allocate(c.capacity, 8);
+		}
+		c.size = tmp.GetCount();
+		file.Seek(c.offset);
+		file.Put(tmp.Begin(), tmp.GetCount());
+	}
+	
+	// Write the chunk table
+	table.chunk_count = chunks.GetCount();
+	int64 table_size = sizeof(CoreCacheChunkTable) + chunks.GetCount() * sizeof(CoreCacheChunk);
+	if (table_size > col.capacity) {
+		header.garbage += col.capacity;
+		col.capacity = CoreCachePageAlign(table_size * 2);
+		col.offset = Allocate(col.capacity);
+	}
+	file.Seek(col.offset);
+	file.Put(&table, sizeof(CoreCacheChunkTable));
+	if (chunks.GetCount())
+		file.Put(chunks.Begin(), chunks.GetCount() * sizeof(CoreCacheChunk));
+}
+
+bool CoreCacheWriter::Close() {
+	if (!file.IsOpen())
+		return false;
+	header.serial++;
+	header.checksum = CoreCacheChecksum(header, columns.Begin());
+	file.Seek((header.serial & 1) * CoreCacheHeaderSize(columns.GetCount()));
+	file.Put(&header, sizeof(CoreCacheHeader));
+	if (columns.GetCount())
+		file.Put(columns.Begin(), columns.GetCount() * sizeof(CoreCacheColumn));
+	file.Close();
+	bool succ = !file.IsError();
+	
+	if (!tmp_path.IsEmpty()) {
+		if (succ)
+			succ = MoveCacheFile(tmp_path, path);
+		if (!succ) {
+			LOG("CoreCacheWriter::Close: error: couldn't replace " + path);
+			FileDelete(tmp_path);
+		}
+		tmp_path.Clear();
+	}
+	return succ;
+}
+
+
+
+
+Atomic& CoreCacheReader::LiveCount() {
+	static Atomic count;
+	return count;
+}
+
+bool CoreCacheReader::Open(const String& path, int column_count) {
+	Close();
+	
+	void* ptr = NULL;
+	#ifdef PLATFORM_WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+	                          NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER file_size;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+		size = file_size.QuadPart;
+		mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	}
+	CloseHandle(file);
+	if (!mapping)
+		return false;
+	ptr = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!ptr)
+		return false;
+	#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		size = st.st_size;
+		ptr = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (ptr == MAP_FAILED)
+			ptr = NULL;
+	}
+	close(fd);
+	if (!ptr)
+		return false;
+	#endif
+	base = (byte*)ptr;
+	AtomicInc(LiveCount());
+	
+	// Use the latest valid header
+	int64 slot_size = CoreCacheHeaderSize(column_count);
+	bool found = false;
+	for(int i = 0; i < 2 && (i + 1) * slot_size <= size; i++) {
+		const byte* slot = base + i * slot_size;
+		CoreCacheHeader h;
+		memcpy(&h, slot, sizeof(CoreCacheHeader));
+		const CoreCacheColumn* cols = (const CoreCacheColumn*)(slot + sizeof(CoreCacheHeader));
+		if (h.magic != CORECACHE_MAGIC ||
+			h.version != CORECACHE_VERSION ||
+			h.column_count != column_count ||
+			h.checksum != CoreCacheChecksum(h, cols) ||
+			(found && h.serial <= header.serial))
+			continue;
+		header = h;
+		columns.SetCount(column_count);
+		if (column_count)
+			memcpy(columns.Begin(), cols, column_count * sizeof(CoreCacheColumn));
+		found = true;
+	}
+	if (!found || header.meta_offset + header.meta_size > size) {
+		Close();
+		return false;
+	}
+	
+	for(int i = 0; i < columns.GetCount(); i++) {
+		const CoreCacheColumn& col = columns[i];
+		if (col.count < 0 || col.offset + col.capacity > size ||
+			(col.codec == CORECACHE_RAW && col.count * (int64)sizeof(double) > col.capacity) ||
+			(col.codec != CORECACHE_RAW && col.codec != CORECACHE_XOR)) {
+			Close();
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+void CoreCacheReader::Close() {
+	if (base) {
+		#ifdef PLATFORM_WIN32
+		UnmapViewOfFile((void*)base);
+		#else
+		munmap((void*)base, (size_t)size);
+		#endif
+		AtomicDec(LiveCount());
+	}
+	base = NULL;
+	size = 0;
+	columns.Clear();
+}
+
+bool CoreCacheReader::LoadColumn(int i, Vector<double>& dst) const {
+	const CoreCacheColumn& col = columns[i];
+	dst.SetCount(col.count);
+	if (!col.count)
+		return true;
+	
+	if (col.codec == CORECACHE_RAW) {
+		memcpy(dst.Begin(), GetColumn(i), col.count * sizeof(double));
+		return true;
+	}
+	
+	CoreCacheChunkTable table;
+	if (col.capacity < (int64)sizeof(CoreCacheChunkTable))
+		return false;
+	memcpy(&table, base + col.offset, sizeof(CoreCacheChunkTable));
+	if (table.zero_prefix < 0 || table.zero_prefix > col.count ||
+		(int64)sizeof(CoreCacheChunkTable) + table.chunk_count * (int64)sizeof(CoreCacheChunk) > col.capacity ||
+		table.chunk_count != (col.count - table.zero_prefix + CORECACHE_CHUNK - 1) / CORECACHE_CHUNK)
+		return false;
+	
+	memset(dst.Begin(), 0, table.zero_prefix * sizeof(double));
+	const byte* chunk_iter = base + col.offset + sizeof(CoreCacheChunkTable);
+	for(int j = 0; j < table.chunk_count; j++) {
+		CoreCacheChunk c;
+		memcpy(&c, chunk_iter + j * sizeof(CoreCacheChunk), sizeof(CoreCacheChunk));
+		int chunk_begin = table.zero_prefix + j * CORECACHE_CHUNK;
+		int chunk_size = min((int)CORECACHE_CHUNK, col.count - chunk_begin);
+		if (c.offset + c.size > size)
+			return false;
+		if (!XorDecode(base + c.offset, c.size, dst.Begin() + chunk_begin, chunk_size))
+			return false;
+	}
+	return true;
+}
+
+}
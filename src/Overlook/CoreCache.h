@@ -0,0 +1,110 @@
+#ifndef _Overlook_CoreCache_h_
+#define _Overlook_CoreCache_h_
+
+namespace Config {
+extern Upp::IniBool compress_corecache;
+}
+
+namespace Overlook {
+using namespace Upp;
+
+// Single file container for cached values of a CoreItem.
+// Two header pages are followed by page aligned regions for the metadata stream and for the
+// values of every buffer. Regions have spare capacity, so new bars are written in place.
+// Moved regions are appended to the end and their old space is not reused before the whole
+// file is rewritten, so the open mappings of the file stay valid. The headers are written in
+// turns and the valid one with the greater serial is used, so an interrupted store leaves the
+// previous header intact.
+struct CoreCacheHeader {
+	dword magic;
+	int version;
+	int column_count;
+	dword checksum;
+	int64 serial;
+	int64 meta_offset, meta_size, meta_capacity;
+	int64 file_end, garbage;
+};
+
+struct CoreCacheColumn {
+	int64 offset, capacity;
+	int count, codec;
+};
+
+// Compressed columns point to a chunk table. Leading zeros are not stored at all and the
+// rest is split to chunks of CORECACHE_CHUNK values, which are XOR encoded separately.
+struct CoreCacheChunkTable {
+	int zero_prefix, chunk_count;
+};
+
+struct CoreCacheChunk {
+	int64 offset;
+	int size, capacity;
+};
+
+enum {CORECACHE_MAGIC = 0x4F434331, CORECACHE_VERSION = 7, CORECACHE_PAGE = 4096, CORECACHE_CHUNK = 4096};
+enum {CORECACHE_MAX_MAPPINGS = 4096};
+enum {CORECACHE_RAW, CORECACHE_XOR};
+
+inline int64 CoreCacheAlign(int64 size, int64 align) {return (size + align - 1) & ~(align - 1);}
+inline int64 CoreCachePageAlign(int64 size) {return CoreCacheAlign(size, CORECACHE_PAGE);}
+inline int64 CoreCacheHeaderSize(int column_count) {return CoreCachePageAlign(sizeof(CoreCacheHeader) + column_count * sizeof(CoreCacheColumn));}
+dword CoreCacheChecksum(const CoreCacheHeader& header, const CoreCacheColumn* columns);
+
+void XorEncode(const double* src, int count, Vector<byte>& out);
+bool XorDecode(const byte* src, int size, double* dst, int count);
+
+class CoreCacheWriter {
+	FileStream file;
+	CoreCacheHeader header;
+	Vector<CoreCacheColumn> columns;
+	Vector<byte> tmp;
+	String path, tmp_path;
+	
+	bool ReadHeader(int column_count);
+	void Grow();
+	int64 Allocate(int64 size, int64 align=CORECACHE_PAGE);
+	void SetRawColumn(CoreCacheColumn& col, const double* data, int count, int begin);
+	void SetXorColumn(CoreCacheColumn& col, const double* data, int count, int begin);
+	
+public:
+	bool Open(const String& path, int column_count, bool recreate=false);
+	void SetMeta(const String& meta);
+	void SetColumn(int i, const double* data, int count, int begin, int codec=CORECACHE_RAW);
+	bool Close();
+	
+	bool IsFragmented() const {return header.garbage > header.file_end / 2;}
+};
+
+// The file is closed after mapping it, so open readers use only address space. The mapping
+// stays valid when the writer appends to the file or replaces it. The mapping is private and
+// writable, so mapped columns can be modified without changing the file.
+class CoreCacheReader {
+	byte* base = NULL;
+	int64 size = 0;
+	CoreCacheHeader header;
+	Vector<CoreCacheColumn> columns;
+	
+	static Atomic& LiveCount();
+	
+public:
+	CoreCacheReader() {}
+	~CoreCacheReader() {Close();}
+	
+	bool Open(const String& path, int column_count);
+	void Close();
+	
+	static bool CanKeepMapping() {return LiveCount() <= CORECACHE_MAX_MAPPINGS;}
+	
+	const byte* GetMeta() const {return base + header.meta_offset;}
+	int64 GetMetaSize() const {return header.meta_size;}
+	int GetColumnCount() const {return columns.GetCount();}
+	int GetCount(int i) const {return columns[i].count;}
+	int GetCodec(int i) const {return columns[i].codec;}
+	int GetCapacity(int i) const {return (int)(columns[i].capacity / sizeof(double));}
+	double* GetColumn(int i) const {return (double*)(base + columns[i].offset);}
+	bool LoadColumn(int i, Vector<double>& dst) const;
+};
+
+}
+
+#endif
@@ -57,6 +57,45 @@ void CoreIO::RefreshBuffers() {
 			buffers.Add(&outputs[j].buffers[i]);
 }
 
+// Assist flags are evaluated once per bar and kept as one bit column per assist type of the
+// factory, so that reading a row later doesn't depend on the cost of Assist.
+void CoreIO::RefreshAssist(int begin) {
+	int count = assist_types.GetCount();
+	if (!count)
+		return;
+	
+	begin = max(0, min(begin, assist_count));
+	assist_write = min(assist_write, begin);
+	for(int i = 0; i < count; i++)
+		assist_columns[i].SetCount(bars);
+	
+	VectorBool vec;
+	vec.SetCount(ASSIST_COUNT);
+	SetSafetyLimit(bars - 1);
+	for(int i = begin; i < bars; i++) {
+		vec.Zero();
+		Assist(i, vec);
+		for(int j = 0; j < count; j++)
+			assist_columns[j].Set(i, vec.Get(assist_types[j]));
+		#ifdef flagDEBUG
+		for(int j = 0; j < count; j++)
+			vec.Set(assist_types[j], false);
+		ASSERT_(vec.PopCount() == 0, "Assist sets a type, which is not registered to the factory");
+		#endif
+	}
+	assist_count = bars;
+}
+
+void CoreIO::GetAssist(int cursor, VectorBool& vec) {
+	if (cursor >= assist_count) {
+		Assist(cursor, vec);
+		return;
+	}
+	for(int i = 0; i < assist_types.GetCount(); i++)
+		if (assist_columns[i].Get(cursor))
+			vec.Set(assist_types[i], true);
+}
+
 void CoreIO::SetInput(int input_id, int sym_id, int tf_id, CoreIO& core, int output_id) {
 	Input& in = inputs[input_id];
 	if (core.GetOutputCount()) {
@@ -84,7 +123,18 @@ const CoreIO& CoreIO::GetInput(int input, int sym, int tf) const {
 	return *inputs[input].Get(HashSymTf(sym, tf)).core;
 }
 
-String CoreIO::GetCacheDirectory() {
+int CoreIO::GetChangeBegin(int64 seen_epoch, int seen_count) {
+	int begin = Upp::max(0, seen_count - 1);
+	LOCK(refresh_lock) {
+		if (seen_epoch < rewrite_floor_epoch)
+			begin = 0;
+		for(int i = rewrites.GetCount() - 1; i >= 0 && rewrites[i].a > seen_epoch; i--)
+			begin = Upp::min(begin, rewrites[i].b);
+	}
+	return begin;
+}
+
+String CoreIO::GetCacheFile() {
 	ASSERT(factory != -1);
 	int64 arghash = 0;
 	Core* core = dynamic_cast<Core*>(this);
@@ -100,44 +150,111 @@ String CoreIO::GetCacheDirectory() {
 		}
 	}
 	
-	String coredir = Format("%d-%d-%d-%d-", sym_id, tf_id, factory, hash) + IntStr64(arghash);
-	String dir = AppendFileName(ConfigFile("corecache"), coredir);
+	String dir = ConfigFile("corecache");
 	RealizeDirectory(dir);
-	return dir;
+	return AppendFileName(dir, Format("%d-%d-%d-%d-", sym_id, tf_id, factory, hash) + IntStr64(arghash) + ".bin");
+}
+
+void CoreIO::GetCacheColumns(Vector<Buffer*>& columns) {
+	for(int i = 0; i < outputs.GetCount(); i++)
+		for(int j = 0; j < outputs[i].buffers.GetCount(); j++)
+			columns.Add(&outputs[i].buffers[j]);
+	Core* c = dynamic_cast<Core*>(this);
+	if (c) {
+		for(int i = 0; i < c->subcores.GetCount(); i++)
+			c->subcores[i].GetCacheColumns(columns);
+	}
+}
+
+// Cores of the cache file in the order of their metadata
+void CoreIO::GetCacheCores(Vector<CoreIO*>& cores) {
+	cores.Add(this);
+	Core* c = dynamic_cast<Core*>(this);
+	if (c) {
+		for(int i = 0; i < c->subcores.GetCount(); i++)
+			cores.Add(&c->subcores[i]);
+	}
 }
 
-void CoreIO::StoreCache() {
+// Buffers are followed by the assist flag columns, which are stored as 64 bit words
+int CoreIO::GetCacheColumnCount() {
+	Vector<Buffer*> columns;
+	GetCacheColumns(columns);
+	Vector<CoreIO*> cores;
+	GetCacheCores(cores);
+	int count = columns.GetCount();
+	for(int i = 0; i < cores.GetCount(); i++)
+		count += cores[i]->assist_types.GetCount();
+	return count;
+}
+
+bool CoreIO::StoreCache() {
 	if (!is_init) {
 		LOG("warning: CoreIO::StoreCache not storing without init");
-		return;
+		return false;
 	}
 	
 	if (!serialized)
-		return;
+		return false;
 	
 	if (outputs.IsEmpty() || outputs.GetCount() == 1 && outputs[0].buffers.IsEmpty())
-		return;
+		return false;
 	
-	if (serialization_lock.TryEnter()) {
-		
-		String dir = GetCacheDirectory();
-		String file = AppendFileName(dir, "core.bin");
-		FileOut out(file);
-		if (!out.IsOpen())
+	if (!serialization_lock.TryEnter())
+		return false;
+	
+	String file = GetCacheFile();
+	Vector<Buffer*> columns;
+	GetCacheColumns(columns);
+	Vector<CoreIO*> cores;
+	GetCacheCores(cores);
+	int column_count = GetCacheColumnCount();
+	
+	CoreCacheWriter out;
+	if (!out.Open(file, column_count))
+		Panic("Couldn't open file: " + file);
+	
+	// Rewrite whole file when most of it is moved columns
+	if (out.IsFragmented()) {
+		out.Close();
+		if (!out.Open(file, column_count, true))
 			Panic("Couldn't open file: " + file);
-		
-		Put(out, dir, 0);
-		Core* c = dynamic_cast<Core*>(this);
-		if (c) {
-			for(int i = 0; i < c->subcores.GetCount(); i++)
-				c->subcores[i].Put(out, dir, 1+i);
+	}
+	
+	StringStream meta;
+	Put(meta, 0);
+	Core* c = dynamic_cast<Core*>(this);
+	if (c) {
+		for(int i = 0; i < c->subcores.GetCount(); i++)
+			c->subcores[i].Put(meta, 1+i);
+	}
+	out.SetMeta(meta.GetResult());
+	
+	// Store values incrementally
+	int codec = Config::compress_corecache ? CORECACHE_XOR : CORECACHE_RAW;
+	for(int i = 0; i < columns.GetCount(); i++) {
+		Buffer& buf = *columns[i];
+		const BufferData& value = buf.value;
+		out.SetColumn(i, value.Begin(), value.GetCount(), buf.GetResetEarliestWrite(), codec);
+	}
+	int col = columns.GetCount();
+	for(int i = 0; i < cores.GetCount(); i++) {
+		CoreIO& core = *cores[i];
+		for(int j = 0; j < core.assist_types.GetCount(); j++) {
+			const VectorBool& bits = core.assist_columns[j];
+			int words = (bits.GetCount() + 63) / 64;
+			out.SetColumn(col++, (const double*)bits.Begin(), words, core.assist_write / 64, codec);
 		}
-		
-		serialization_lock.Leave();
+		core.assist_write = INT_MAX;
 	}
+	
+	bool succ = out.Close();
+	
+	serialization_lock.Leave();
+	return succ;
 }
 
-void CoreIO::Put(Stream& out, const String& dir, int subcore_id) {
+void CoreIO::Put(Stream& out, int subcore_id) {
 	int output_count = outputs.GetCount();
 	int persistent_count = persistents.GetCount();
 	int job_count = jobs.GetCount();
@@ -159,73 +276,276 @@ void CoreIO::Put(Stream& out, const String& dir, int subcore_id) {
 		
 		// VectorBool label is typically around 1-10K bytes and that's not too much.
 		out % output.label;
-		
-		for(int j = 0; j < output.buffers.GetCount(); j++) {
-			Buffer& buf = output.buffers[j];
-			
-			// Store values incrementally
-			String file = AppendFileName(dir, Format("%d-%d-%d.bin", i, j, subcore_id));
-			FileAppend out(file);
-			if (!out.IsOpen())
-				Panic("Couldn't open file: " + file);
-			
-			int begin = buf.GetResetEarliestWrite();
-			int64 add = begin != INT_MAX ? buf.value.GetCount() - begin : -1;
-			if (add > 0) {
-				out.Seek(begin * sizeof(double));
-				out.Put(buf.value.Begin() + begin, (int)(add * sizeof(double)));
-			}
-		}
 	}
 	
+	int assist_column_count = assist_types.GetCount();
+	out % assist_count % assist_column_count;
+	
 }
 
 void CoreIO::LoadCache() {
 	if (!serialized)
 		return;
 	
-	String dir = GetCacheDirectory();
+	String file = GetCacheFile();
+	Vector<Buffer*> columns;
+	GetCacheColumns(columns);
+	Vector<CoreIO*> cores;
+	GetCacheCores(cores);
 	
-	String file = AppendFileName(dir, "core.bin");
-	FileIn in(file);
-	if (!in.IsOpen())
+	RealizeCache();
+	cache_reader.Create();
+	CoreCacheReader& in = *cache_reader;
+	if (!in.Open(file, GetCacheColumnCount())) {
+		cache_reader.Clear();
 		return;
+	}
 	
-	Get(in, dir, 0);
+	// The counters are set only after everything has been read
+	MemReadStream meta(in.GetMeta(), in.GetMetaSize());
+	Array<CacheState> states;
+	bool succ = Get(meta, 0, states.Add());
 	Core* c = dynamic_cast<Core*>(this);
+	if (c) {
+		for(int i = 0; i < c->subcores.GetCount() && succ; i++)
+			succ = c->subcores[i].Get(meta, 1+i, states.Add());
+	}
+	if (!succ) {
+		RestoreCacheState(states[0]);
+		for(int i = 1; i < states.GetCount(); i++)
+			c->subcores[i-1].RestoreCacheState(states[i]);
+		cache_reader.Clear();
+		if (c) c->ClearContent();
+		return;
+	}
+	
+	// Uncompressed columns are read lazily from the mapped file, unless there are too many
+	// mappings open already
+	bool keep_mapping = CoreCacheReader::CanKeepMapping();
+	bool mapped = false;
+	for(int i = 0; i < columns.GetCount(); i++) {
+		Buffer& buf = *columns[i];
+		if (keep_mapping && in.GetCodec(i) == CORECACHE_RAW && in.GetCount(i) > 0) {
+			buf.value.Map(in.GetColumn(i), in.GetCount(i), in.GetCapacity(i));
+			mapped = true;
+		}
+		else if (!in.LoadColumn(i, buf.value.GetVector())) {
+			LOG("CoreIO::LoadCache: error: invalid column in " + file);
+			succ = false;
+			break;
+		}
+	}
+	int col = columns.GetCount();
+	Vector<double> words;
+	for(int i = 0; i < cores.GetCount() && succ; i++) {
+		CacheState& state = states[i];
+		int word_count = (state.assist_count + 63) / 64;
+		state.assist_columns.SetCount(cores[i]->assist_types.GetCount());
+		for(int j = 0; j < state.assist_columns.GetCount(); j++) {
+			if (!in.LoadColumn(col++, words) || words.GetCount() < word_count) {
+				LOG("CoreIO::LoadCache: error: invalid assist column in " + file);
+				succ = false;
+				break;
+			}
+			VectorBool& bits = state.assist_columns[j];
+			bits.SetCount(state.assist_count);
+			if (word_count)
+				memcpy(bits.Begin(), words.Begin(), word_count * sizeof(uint64));
+		}
+	}
+	if (!succ) {
+		for(int i = 0; i < columns.GetCount(); i++)
+			columns[i]->value.Clear();
+		RestoreCacheState(states[0]);
+		for(int i = 1; i < states.GetCount(); i++)
+			c->subcores[i-1].RestoreCacheState(states[i]);
+		cache_reader.Clear();
+		if (c) c->ClearContent();
+		return;
+	}
+	
+	SetCacheState(states[0]);
 	if (c) {
 		for(int i = 0; i < c->subcores.GetCount(); i++)
-			c->subcores[i].Get(in, dir, 1+i);
+			c->subcores[i].SetCacheState(states[1+i]);
+	}
+	if (!mapped)
+		cache_reader.Clear();
+}
+
+void CoreIO::SetCacheState(CacheState& state) {
+	counted = state.counted;
+	
+	// system.bin is stored later than the caches, so the time axis of the previous run might
+	// have ended before the cached bars
+	System& sys = GetSystem();
+	if (sym_id >= 0 && sym_id < sys.GetSymbolCount() && tf_id >= 0 && tf_id < sys.GetPeriodCount())
+		counted = min(counted, sys.GetCountTf(sym_id, tf_id));
+	bars = state.bars;
+	assist_count = state.assist_count;
+	assist_columns = pick(state.assist_columns);
+	
+	for(int i = 0; i < jobs.GetCount(); i++) {
+		Job& job = jobs[i];
+		const Job& src = state.jobs[i];
+		job.title = src.title;
+		job.actual = src.actual;
+		job.total = src.total;
+		job.state = src.state;
 	}
+	for(int i = 0; i < outputs.GetCount(); i++)
+		outputs[i].label = pick(state.labels[i]);
 }
 
-void CoreIO::Get(Stream& in, const String& dir, int subcore_id) {
+void CoreIO::RestoreCacheState(CacheState& state) {
+	if (!state.restore)
+		return;
+	StringStream s(state.persistents);
+	for(int i = 0; i < persistents.GetCount(); i++)
+		persistents[i].Serialize(s);
+	state.restore = false;
+}
+
+// Values are copied from the mapped file. The mapping is kept until ReleaseMemory, because
+// other cores might still have pointers to it.
+void CoreIO::RealizeCache() {
+	if (cache_reader.IsEmpty())
+		return;
+	Vector<Buffer*> columns;
+	GetCacheColumns(columns);
+	for(int i = 0; i < columns.GetCount(); i++)
+		columns[i]->value.Realize();
+	retired_readers.Add(cache_reader.Detach());
+}
+
+bool CoreIO::MapCache() {
+	if (!CoreCacheReader::CanKeepMapping())
+		return false;
+	
+	Vector<Buffer*> columns;
+	GetCacheColumns(columns);
+	
+	One<CoreCacheReader> reader;
+	reader.Create();
+	if (!reader->Open(GetCacheFile(), GetCacheColumnCount()))
+		return false;
+	
+	for(int i = 0; i < columns.GetCount(); i++) {
+		BufferData& value = columns[i]->value;
+		int count = value.GetCount();
+		if (reader->GetCodec(i) == CORECACHE_RAW && reader->GetCount(i) == count && count > 0)
+			value.Map(reader->GetColumn(i), count, reader->GetCapacity(i));
+		else if (value.IsMapped())
+			value.Realize();
+	}
+	if (!cache_reader.IsEmpty())
+		retired_readers.Add(cache_reader.Detach());
+	cache_reader.Attach(reader.Detach());
+	return true;
+}
+
+bool CoreIO::ReleaseMemory() {
+	if (!is_init || !serialized)
+		return false;
+	
+	// Stored values are mapped back from the cache file and only the modified pages are copied
+	// again. Only uncompressed columns can be mapped, so compressed caches stay in memory.
+	if (!pin_lock.TryEnter())
+		return false;
+	bool released = false;
+	if (!pin_count && refresh_lock.TryEnter()) {
+		if (StoreCache())
+			released = MapCache();
+		retired_readers.Clear();
+		refresh_lock.Leave();
+	}
+	pin_lock.Leave();
+	return released;
+}
+
+// Pinned cores are being read, so their values are not released
+void CoreIO::Pin() {
+	pin_lock.Enter();
+	pin_count++;
+	pin_lock.Leave();
+}
+
+void CoreIO::Unpin() {
+	pin_lock.Enter();
+	ASSERT(pin_count > 0);
+	pin_count--;
+	pin_lock.Leave();
+}
+
+void CoreIO::PinSources() {
+	for(int i = 0; i < inputs.GetCount(); i++) {
+		Input& in = inputs[i];
+		for(int j = 0; j < in.GetCount(); j++) {
+			CoreIO* core = in[j].core;
+			if (core && core != this)
+				core->Pin();
+		}
+	}
+}
+
+void CoreIO::UnpinSources() {
+	for(int i = 0; i < inputs.GetCount(); i++) {
+		Input& in = inputs[i];
+		for(int j = 0; j < in.GetCount(); j++) {
+			CoreIO* core = in[j].core;
+			if (core && core != this)
+				core->Unpin();
+		}
+	}
+}
+
+int64 CoreIO::GetMemoryUsage() {
+	Vector<Buffer*> columns;
+	GetCacheColumns(columns);
+	int64 bytes = 0;
+	for(int i = 0; i < columns.GetCount(); i++)
+		bytes += columns[i]->value.GetMemoryUsage();
+	return bytes;
+}
+
+void CoreIO::Prefetch(int begin, int end) {
+	Vector<Buffer*> columns;
+	GetCacheColumns(columns);
+	for(int i = 0; i < columns.GetCount(); i++)
+		columns[i]->Prefetch(begin, end);
+}
+
+bool CoreIO::Get(Stream& in, int subcore_id, CacheState& state) {
 	int output_count = 0;
 	in % output_count;
 	if (output_count != outputs.GetCount()) {
 		LOG("CoreIO::LoadCache: error: output count mismatch");
-		return;
+		return false;
 	}
 	
 	int persistent_count = 0;
 	in % persistent_count;
 	if (persistent_count != persistents.GetCount()) {
 		LOG("CoreIO::LoadCache: error: persistent variable count mismatch");
-		return;
+		return false;
 	}
 	
-	int counted, bars;
-	in % counted % bars;
+	in % state.counted % state.bars;
 	
 	int job_count;
 	in % job_count;
 	if (job_count != jobs.GetCount()) {
 		LOG("CoreIO::LoadCache: error: persistent variable count mismatch");
-		return;
+		return false;
 	}
 	for(int i = 0; i < jobs.GetCount(); i++)
-		in % jobs[i];
+		in % state.jobs.Add();
 	
+	StringStream backup;
+	for(int i = 0; i < persistents.GetCount(); i++)
+		persistents[i].Serialize(backup);
+	state.persistents = backup.GetResult();
+	state.restore = true;
 	for(int i = 0; i < persistents.GetCount(); i++) {
 		Persistent& p = persistents[i];
 		p.Serialize(in);
@@ -237,34 +557,22 @@ void CoreIO::Get(Stream& in, const String& dir, int subcore_id) {
 		
 		Output& output = outputs[i];
 		
-		in % output.label;
+		in % state.labels.Add();
 		
 		if (output.phase != phase || output.type != type || output.visible != visible) {
 			LOG("CoreIO::LoadCache: error: output type mismatch");
-			return;
-		}
-		
-		for(int j = 0; j < output.buffers.GetCount(); j++) {
-			Buffer& buf = output.buffers[j];
-			
-			// Store values incrementally
-			String file = AppendFileName(dir, Format("%d-%d-%d.bin", i, j, subcore_id));
-			FileIn in(file);
-			if (!in.IsOpen()) {
-				LOG("CoreIO::LoadCache: error: file doesn't exist: " + file);
-				continue;
-			}
-			
-			int count = (int)(in.GetSize() / sizeof(double));
-			if (count > 0) {
-				buf.value.SetCount(count);
-				in.Get(buf.value.Begin(), count * sizeof(double));
-			}
+			return false;
 		}
 	}
 	
-	this->counted = counted;
-	this->bars = bars;
+	int assist_column_count = 0;
+	in % state.assist_count % assist_column_count;
+	if (assist_column_count != assist_types.GetCount()) {
+		LOG("CoreIO::LoadCache: error: assist column count mismatch");
+		return false;
+	}
+	
+	return !in.IsError();
 }
 
 void CoreIO::ForceCount(int data_count) {
@@ -44,28 +44,44 @@ inline RandomGaussian& GetRandomGaussian(int length) {
 }
 
 
-//speed up the memcpy process!
 template <class T>
 void copy_linear(T* write, const T* read, unsigned int size) {
-	int* w4 = (int*)write;
-	int* r4 = (int*)read;
-	unsigned int scan=0;
-	
-	ASSERT(size % sizeof(int) == 0);
-	
-	while (size >= 4) {
-		w4[scan] = r4[scan];
-		size -= 4;
-		scan++;
-	}
+	memcpy(write, read, size);
 }
 
 #define COPY(type, dst, src, count) copy_linear(dst, src, sizeof(type) * count)
-#define ZERO(dst, count) {for(int i = 0; i < count; i++) dst[i] = 0;}
+#define ZERO(dst, count) memset(dst, 0, sizeof(*(dst)) * (count))
 #define SET(dst, count, value) {for(int i = 0; i < count; i++) dst[i] = value;}
 #define RAND(dst, count) {RandomGaussian& rand = GetRandomGaussian(count);	for (int i = 0; i < count; i++) {dst.Set(i, rand);}}
 
 
+// Cache line aligned blocks for the matrix storage
+enum {MAT_ALIGN = 64};
+
+inline void* MatAlloc(size_t size) {
+	byte* raw = (byte*)MemoryAlloc(size + MAT_ALIGN + sizeof(void*));
+	byte* p = raw + sizeof(void*);
+	p += (MAT_ALIGN - (uintptr_t)p % MAT_ALIGN) % MAT_ALIGN;
+	((void**)p)[-1] = raw;
+	return p;
+}
+
+inline void MatFree(void* p) {
+	if (p) MemoryFree(((void**)p)[-1]);
+}
+
+// y[i] += a * x[i]
+template <class T>
+inline void MatAxpy(T a, const T* x, T* y, int count) {
+	for(int i = 0; i < count; i++)
+		y[i] += a * x[i];
+}
+
+inline void MatAxpy(double a, const double* x, double* y, int count) {
+	GetGemmKernels().axpy(a, x, y, count);
+}
+
+
 
 
 
@@ -75,12 +91,14 @@ void copy_linear(T* write, const T* read, unsigned int size) {
 
 
 
+// The weights and the gradients are in separate aligned heap blocks. The gradients are allocated
+// at the first write, so copies for the evaluation only don't carry them.
 template <class T, int width, int height>
 class Mat : Moveable<Mat<T, width, height> > {
 	static const int length = width * height;
 	
-	T weight_gradients[length];
-	T weights[length];
+	T* weight_gradients = NULL;
+	T* weights = NULL;
 	
 	typedef Mat<T, width, height> MatType;
 	
@@ -94,51 +112,91 @@ protected:
 		return i;
 	}
 	
+	T* Gradients() {
+		if (!weight_gradients) {
+			weight_gradients = (T*)MatAlloc(sizeof(T) * length);
+			ZERO(weight_gradients, length);
+		}
+		return weight_gradients;
+	}
+	
+	void ZeroGradientsIfAny() {if (weight_gradients) ZERO(weight_gradients, length);}
+	
+	void SerializeValues(Stream& s, T* values) {
+		if (s.IsStoring())			s.Put(values, sizeof(T) * length);
+		else if (s.IsLoading())		s.Get(values, sizeof(T) * length);
+	}
+	
 public:
 	
-	Mat() {}
-	Mat(MatType& vol) {COPY(T, this->weights, vol.weights, length); ZERO(weight_gradients, length);}
-	Mat(const T weights[length]) {COPY(T, this->weights, weights, length); ZERO(weight_gradients, length);}
-	Mat(const MatType& o) {*this = o;}
-	Mat(T default_value) {SET(weights, length, default_value); ZERO(weight_gradients, length);}
-	Mat& Init() {RAND(weights, length); ZERO(weight_gradients, length); return *this;}
-	Mat& Init(const T weights[length]) {COPY(T, this->weights, weights, length); ZERO(weight_gradients, length); return *this;}
-	Mat& Init(T default_value) {SET(weights, length, default_value); ZERO(weight_gradients, length); return *this;}
+	Mat() {weights = (T*)MatAlloc(sizeof(T) * length); ZERO(weights, length);}
+	Mat(MatType& vol) : Mat() {COPY(T, this->weights, vol.weights, length);}
+	Mat(const T weights[length]) : Mat() {COPY(T, this->weights, weights, length);}
+	Mat(const MatType& o) : Mat() {*this = o;}
+	Mat(T default_value) : Mat() {SET(weights, length, default_value);}
+	~Mat() {MatFree(weights); MatFree(weight_gradients);}
+	Mat& Init() {RAND((*this), length); ZeroGradientsIfAny(); return *this;}
+	Mat& Init(const T weights[length]) {COPY(T, this->weights, weights, length); ZeroGradientsIfAny(); return *this;}
+	Mat& Init(T default_value) {SET(weights, length, default_value); ZeroGradientsIfAny(); return *this;}
 	
 	void Serialize(Stream& s) {
-		if (s.IsStoring()) {
-			s.Put(weights,				sizeof(T) * length);
-			s.Put(weight_gradients,		sizeof(T) * length);
+		SerializeValues(s, weights);
+		if (weight_gradients)
+			SerializeValues(s, weight_gradients);
+		else if (s.IsStoring()) {
+			Buffer<T> zero(length, 0);
+			s.Put(zero, sizeof(T) * length);
 		}
 		else if (s.IsLoading()) {
-			s.Get(weights,				sizeof(T) * length);
-			s.Get(weight_gradients,		sizeof(T) * length);
+			// The stored gradients are skipped, so that loading doesn't allocate them
+			Buffer<T> tmp(length);
+			s.Get(tmp, sizeof(T) * length);
 		}
 	}
 	
-	Mat& operator=(const MatType& src) {COPY(T, this->weights, src.weights, length); COPY(T, this->weight_gradients, src.weight_gradients, length); return *this;}
+	Mat& operator=(const MatType& src) {
+		if (this == &src) return *this;
+		COPY(T, this->weights, src.weights, length);
+		if (src.weight_gradients) COPY(T, Gradients(), src.weight_gradients, length);
+		else ZeroGradientsIfAny();
+		return *this;
+	}
+	
+	// Copies the weights only and drops the gradients
+	void CopyWeights(const MatType& src) {COPY(T, this->weights, src.weights, length); FreeGradients();}
+	void FreeGradients() {MatFree(weight_gradients); weight_gradients = NULL;}
+	bool HasGradients() const {return weight_gradients;}
 	
 	const T* GetWeights()   const {return weights;}
 	const T* GetGradients() const {return weight_gradients;}
+	T* GetWeights()   {return weights;}
+	T* GetGradients() {return Gradients();}
 	
 	void Add(int i, T v) {weights[Pos(i)] += v;}
 	void Add(int x, int y, T v) {weights[GetPos(x,y)] += v;}
-	void AddFrom(const MatType& volume) {for (int i = 0; i < length; i++) {weights[i] += volume.weights[i];}}
-	void AddFromScaled(const Mat& volume, T a) {for (int i = 0; i < length; i++) {weights[i] += a * volume.weights[i];}}
-	void AddGradient(int x, int y, T v) {weight_gradients[GetPos(x,y)] += v;}
-	void AddGradient(int i, T v) {weight_gradients[Pos(i)] += v;}
-	void AddGradientFrom(const Mat& volume) {for (int i = 0; i < length; i++) {weight_gradients[i] += volume.weight_gradients[i];}}
+	void AddFrom(const MatType& volume) {MatAxpy((T)1, volume.weights, weights, length);}
+	void AddFromScaled(const Mat& volume, T a) {MatAxpy(a, volume.weights, weights, length);}
+	void AddGradient(int x, int y, T v) {Gradients()[GetPos(x,y)] += v;}
+	void AddGradient(int i, T v) {Gradients()[Pos(i)] += v;}
+	void AddGradientFrom(const Mat& volume) {if (volume.weight_gradients) MatAxpy((T)1, volume.weight_gradients, Gradients(), length);}
 	T Get(int x, int y) const {return weights[GetPos(x, y)];}
-	T GetGradient(int x, int y) const {return weight_gradients[GetPos(x, y)];}
+	T GetGradient(int x, int y) const {return weight_gradients ? weight_gradients[GetPos(x, y)] : 0;}
 	void Set(int x, int y, T v) {weights[GetPos(x, y)] = v;}
-	void SetConst(T c) {for (int i = 0; i < length; i++) {weights[i] = c;}}
-	void SetConstGradient(T c) {for (int i = 0; i < length; i++) {weight_gradients[i] = c;}}
-	void SetGradient(int x, int y, T v) {weight_gradients[GetPos(x, y)] = v;}
+	void SetConst(T c) {SET(weights, length, c);}
+	void SetConstGradient(T c) {if (c == 0) ZeroGradientsIfAny(); else SET(Gradients(), length, c);}
+	void SetGradient(int x, int y, T v) {Gradients()[GetPos(x, y)] = v;}
 	T Get(int i) const {return weights[Pos(i)];}
 	void Set(int i, T v) {weights[Pos(i)] = v;}
-	T GetGradient(int i) const {return weight_gradients[Pos(i)];}
-	void SetGradient(int i, T v) {weight_gradients[Pos(i)] = v;}
-	void ZeroGradients() {for (int i = 0; i < length; i++) {weight_gradients[i] = 0;}}
+	T GetGradient(int i) const {return weight_gradients ? weight_gradients[Pos(i)] : 0;}
+	void SetGradient(int i, T v) {Gradients()[Pos(i)] = v;}
+	void ZeroGradients() {ZeroGradientsIfAny();}
+	
+	// weights -= alpha * gradients, and the gradients are cleared
+	void Update(T alpha) {
+		if (!weight_gradients) return;
+		MatAxpy(-alpha, weight_gradients, weights, length);
+		ZERO(weight_gradients, length);
+	}
 	
 	int GetWidth() const {return width;}
 	int GetHeight() const {return height;}
@@ -366,25 +424,11 @@ void RandMat(double mu, double std, T& m) {
 }
 
 
-template <class MatType>
-void UpdateMat(MatType& m, double alpha) {
-	// updates in place
-	for (int i = 0; i < m.GetLength(); i++) {
-		double d = m.GetGradient(i);
-		m.Add(i, -alpha * d);
-		m.SetGradient(i, 0);
-	}
-}
-
-
-
 template <int num_actions, int num_states, int num_hidden_units = 100>
 class DQNTrainer {
 	
 public:
 	
-	typedef Mat<double, 1, num_states> MatType;
-	
 	struct Data {
 	
 		Mat<double, num_states, num_hidden_units>			W1;
@@ -392,7 +436,8 @@ public:
 		Mat<double, num_hidden_units, num_actions>			W2;
 		Mat<double, 1, num_actions>							b2;
 		
-		// width = agent-width * agent-height, height = W1.height
+		// The layers of the dense graph aren't used by the bit rows, but they are in the stored
+		// trainer. width = agent-width * agent-height, height = W1.height
 		RecurrentMul<1, num_hidden_units>					mul1;
 		RecurrentAdd<1, num_hidden_units>					add1;
 		RecurrentTanh<1, num_hidden_units>					tanh;
@@ -404,7 +449,16 @@ public:
 	
 	Data data;
 	
-	typedef  Mat<double, 1, num_actions>				FwdOut;
+	// Temporary values of the batched training. The gradients of b1, W2 and b2 are collected
+	// here instead of the matrices, so that several batches can be learned at the same time.
+	struct Batch {
+		Vector<double> a1, h, out, d_out, d_h;
+		Vector<double> g_b1, g_W2, g_b2;
+		Vector<int> idx, idx_end;
+	};
+	
+	Batch batch;
+	
 	typedef  DQItem<1, num_states>						DQItemType;
 	typedef  DQVector<num_actions>						DQVectorType;
 	
@@ -416,6 +470,115 @@ protected:
 	
 	
 	
+	void SetBatchCount(Batch& b, int count) {
+		b.a1.SetCount(count * num_hidden_units);
+		b.h.SetCount(count * num_hidden_units);
+		b.out.SetCount(count * num_actions);
+		b.d_out.SetCount(count * num_actions);
+		b.d_h.SetCount(count * num_hidden_units);
+	}
+	
+	void AddBitIndices(Batch& b, const uint64* row) {
+		for(int i = 0; i < num_states; i += 64) {
+			uint64 bits = row[i >> 6];
+			while (bits) {
+				int j = i + TrailingZeros64(bits);
+				if (j < num_states)
+					b.idx.Add(j);
+				bits &= bits - 1;
+			}
+		}
+		b.idx_end.Add(b.idx.GetCount());
+	}
+	
+	void ForwardBits(Batch& b, int n) {
+		const int S = num_states, H = num_hidden_units;
+		const int* it  = b.idx.Begin() + (n ? b.idx_end[n - 1] : 0);
+		const int* end = b.idx.Begin() + b.idx_end[n];
+		const double* w = data.W1.GetWeights();
+		double* a1 = b.a1.Begin() + n * H;
+		for(int i = 0; i < H; i++) {
+			const double* wi = w + i * S;
+			double sum = data.b1.Get(i);
+			for(const int* j = it; j != end; j++)
+				sum += wi[*j];
+			a1[i] = sum;
+		}
+	}
+	
+	// h = tanh(a1), out = W2 * h + b2
+	void ForwardHidden(Batch& b, int count) {
+		const int H = num_hidden_units, A = num_actions;
+		for(int i = 0; i < count * H; i++)
+			b.h[i] = tanh(b.a1[i]);
+		for(int n = 0; n < count; n++)
+			for(int i = 0; i < A; i++)
+				b.out[n * A + i] = data.b2.Get(i);
+		GemmNT(b.h.Begin(), H, data.W2.GetWeights(), H, b.out.Begin(), A, count, A, H);
+	}
+	
+	// Computes the outputs from a1 and the gradients of everything but W1. The gradient of a1
+	// is left to d_h. The gradients are averaged over the batch, so a step has the same size
+	// with any batch size. Returns the mean absolute error.
+	double LearnHidden(Batch& b, const DQVectorType* const* vecs, int count) {
+		const int H = num_hidden_units, A = num_actions;
+		ForwardHidden(b, count);
+		
+		// Clamped errors of the outputs
+		double err_sum = 0.0;
+		double scale = count ? 1.0 / count : 0.0;
+		for(int n = 0; n < count; n++) {
+			const DQVectorType& vec = *vecs[n];
+			for(int i = 0; i < A; i++) {
+				double err = b.out[n * A + i] - vec.correct[i];
+				if      (err > +tderror_clamp) err = +tderror_clamp;
+				else if (err < -tderror_clamp) err = -tderror_clamp;
+				b.d_out[n * A + i] = err * scale;
+				err_sum += fabs(err);
+			}
+		}
+		
+		b.g_W2.SetCount(A * H);
+		b.g_b1.SetCount(H);
+		b.g_b2.SetCount(A);
+		ZERO(b.g_W2.Begin(), A * H);
+		ZERO(b.g_b1.Begin(), H);
+		ZERO(b.g_b2.Begin(), A);
+		GemmTN(b.d_out.Begin(), A, b.h.Begin(), H, b.g_W2.Begin(), H, A, H, count);
+		for(int i = 0; i < count * H; i++)
+			b.d_h[i] = 0.0;
+		GemmNN(b.d_out.Begin(), A, data.W2.GetWeights(), H, b.d_h.Begin(), H, count, H, A);
+		for(int i = 0; i < count * H; i++) {
+			double h = b.h[i];
+			b.d_h[i] *= 1.0 - h * h;
+		}
+		for(int n = 0; n < count; n++) {
+			for(int i = 0; i < H; i++) b.g_b1[i] += b.d_h[n * H + i];
+			for(int i = 0; i < A; i++) b.g_b2[i] += b.d_out[n * A + i];
+		}
+		
+		return count ? err_sum / (count * A) : 0.0;
+	}
+	
+	// The gradient of W1 is d_h in the columns of the set bits, so it's applied directly
+	void UpdateBits(Batch& b, int count) {
+		const int S = num_states, H = num_hidden_units;
+		double* w = data.W1.GetWeights();
+		for(int n = 0; n < count; n++) {
+			const int* it  = b.idx.Begin() + (n ? b.idx_end[n - 1] : 0);
+			const int* end = b.idx.Begin() + b.idx_end[n];
+			const double* d_h = b.d_h.Begin() + n * H;
+			for(int i = 0; i < H; i++) {
+				double step = alpha * d_h[i];
+				if (step == 0.0)
+					continue;
+				double* wi = w + i * S;
+				for(const int* j = it; j != end; j++)
+					wi[*j] -= step;
+			}
+		}
+	}
+	
 public:
 
 	DQNTrainer() {
@@ -443,122 +606,65 @@ public:
 		tderror = 0; // for visualization only...
 	}
 	
-	FwdOut& Forward(MatType& input) {
-		// Original:
-		//		var a1mat = G.Add(G.Mul(net.W1, s), net.b1);
-		//		var h1mat = G.Tanh(a1mat);
-		//		var a2mat = G.Add(G.Mul(net.W2, h1mat), net.b2);
-		data.mul1.Forward(data.W1,			input);
-		data.add1.Forward(data.mul1.output,	data.b1);
-		data.tanh.Forward(data.add1.output);
-		data.mul2.Forward(data.W2,			data.tanh.output);
-		data.add2.Forward(data.mul2.output,	data.b2);
-		
-		return data.add2.output;
-	}
-	
-	void Backward(MatType& input) {
-		data.add2.Backward(data.mul2.output,	data.b2);
-		data.mul2.Backward(data.W2,				data.tanh.output);
-		data.tanh.Backward(data.add1.output);
-		data.add1.Backward(data.mul1.output,	data.b1);
-		data.mul1.Backward(data.W1,				input);
-	}
-	
-	int Act(MatType& before_state) {
-		
-		// epsilon greedy policy
-		int action;
-		if (epsilon > 0.0 && Randomf() < epsilon) {
-			action = Random(num_actions);
-		} else {
-			// greedy wrt Q function
-			FwdOut& amat = Forward(before_state);
-			action = amat.GetMaxColumn(); // returns index of argmax action
-		}
-		
-		return action;
-	}
 	
-	void Evaluate(MatType& before_state, DQVectorType& out) {
-		
-		// greedy wrt Q function
-		FwdOut& amat = Forward(before_state);
+	// Binary inputs: a state is a bit row, where a set bit is an input of 1.0 and a cleared bit
+	// is 0.0. The first layer is the sum of the W1 columns of the set bits and only those
+	// columns are updated.
+	void EvaluateBits(const uint64* row, DQVectorType& out) {
+		Batch& b = batch;
+		SetBatchCount(b, 1);
+		b.idx.SetCount(0);
+		b.idx_end.SetCount(0);
+		AddBitIndices(b, row);
+		ForwardBits(b, 0);
+		ForwardHidden(b, 1);
 		
 		// epsilon greedy policy
 		if (epsilon > 0.0 && Randomf() < epsilon) {
 			for(int i = 0; i < num_actions; i++)
-				out.weight[i] = amat.Get(Random(num_actions));
+				out.weight[i] = b.out[Random(num_actions)];
 		} else {
 			for(int i = 0; i < num_actions; i++)
-				out.weight[i] = amat.Get(i);
+				out.weight[i] = b.out[i];
 		}
 	}
 	
-	double Learn(MatType& s0, int a0, double reward0, MatType& s1) {
-		
-		// compute the target Q value
-		double qmax = reward0;
-		if (gamma > 0.0) {
-			FwdOut& tmat = Forward(s1);
-			qmax += gamma * tmat.Get(tmat.GetMaxColumn());
-		}
-		
-		// now predict
-		FwdOut& pred = Forward(s0);
-		
-		double tderror = pred.Get(a0) - qmax;
-		double clamp = tderror_clamp;
-		double abs_tderror = tderror >= 0.0 ? +tderror : -tderror;
-		if (abs_tderror > clamp) {
-			// huber loss to robustify
-			if (tderror > clamp)
-				tderror = +clamp;
-			else
-				tderror = -clamp;
-		}
-		pred.SetGradient(a0, tderror);
-		Backward(s0); // compute gradients on net params
-		
-		// update net
-		UpdateMat(data.W1, alpha);
-		UpdateMat(data.b1, alpha);
-		UpdateMat(data.W2, alpha);
-		UpdateMat(data.b2, alpha);
-		
+	double LearnBatchBits(const uint64* const* rows, const DQVectorType* const* vecs, int count) {
+		tderror = LearnBatchBits(batch, rows, vecs, count);
+		UpdateHidden(batch);
 		return tderror;
 	}
 	
-	double Learn(MatType& s0, const DQVectorType& vec, MatType& s1) {
-		
-		// now predict
-		FwdOut& pred = Forward(s0);
-		
-		for (int i = 0; i < num_actions; i++) {
-			double tderror = pred.Get(i) - vec.correct[i];
-			double clamp = tderror_clamp;
-			double abs_tderror = tderror >= 0.0 ? +tderror : -tderror;
-			if (abs_tderror > clamp) {
-				// huber loss to robustify
-				if (tderror > clamp)
-					tderror = +clamp;
-				else
-					tderror = -clamp;
-			}
-			pred.SetGradient(i, tderror);
+	// Hogwild training: several threads may learn at once, each with its own Batch. Only the
+	// sparse W1 columns are updated here without locking, so a thread may miss the latest
+	// updates of the others. The dense gradients of b1, W2 and b2 are left to the Batch and
+	// must be applied with UpdateHidden after all threads have finished.
+	double LearnBatchBits(Batch& b, const uint64* const* rows, const DQVectorType* const* vecs, int count) {
+		SetBatchCount(b, count);
+		b.idx.SetCount(0);
+		b.idx_end.SetCount(0);
+		for(int n = 0; n < count; n++) {
+			AddBitIndices(b, rows[n]);
+			ForwardBits(b, n);
 		}
-		Backward(s0); // compute gradients on net params
+		
+		double err = LearnHidden(b, vecs, count);
 		
 		// update net
-		UpdateMat(data.W1, alpha);
-		UpdateMat(data.b1, alpha);
-		UpdateMat(data.W2, alpha);
-		UpdateMat(data.b2, alpha);
+		UpdateBits(b, count);
 		
-		return tderror;
+		return err;
+	}
+	
+	void UpdateHidden(Batch& b) {
+		const int H = num_hidden_units, A = num_actions;
+		MatAxpy(-alpha, b.g_b1.Begin(), data.b1.GetWeights(), H);
+		MatAxpy(-alpha, b.g_W2.Begin(), data.W2.GetWeights(), A * H);
+		MatAxpy(-alpha, b.g_b2.Begin(), data.b2.GetWeights(), A);
 	}
 	
 	double GetTDError() const {return tderror;}
+	void   SetTDError(double d) {tderror = d;}
 	double GetEpsilon() const {return epsilon;}
 	
 	void SetEpsilon(double e) {epsilon = e;}
@@ -54,17 +54,14 @@ void DataBridge::Start() {
 				for(int i = 0; i < SYM_COUNT; i++)
 					corr[0].sym_ids[i] = sys.GetPrioritySymbol(i);
 				
-				corr[0].averages.SetCount(SYM_COUNT-1);
-				corr[0].buffer.SetCount(SYM_COUNT-1);
-				
-				for(int i = 0; i < SYM_COUNT-1; i++) {
-					corr[0].averages[i].SetPeriod(corr[0].period);
-				}
 			}
+			int series = corr[0].sym_ids.GetCount();
+			corr[0].buffer.SetCount(series-1);
+			corr[0].matrix.SetSize(series, corr[0].period);
 			
 			
-			corr[0].opens.SetCount(SYM_COUNT, 0);
-			for(int i = 0; i < SYM_COUNT; i++) {
+			corr[0].opens.SetCount(series, 0);
+			for(int i = 0; i < series; i++) {
 				ConstBuffer& open = GetInputBuffer(0, corr[0].sym_ids[i], GetTimeframe(), 0);
 				corr[0].opens[i] = &open;
 			}
@@ -96,17 +93,7 @@ void DataBridge::Start() {
 	if (sym < sym_count) {
 		bool init_round = GetCounted() == 0;
 		if (init_round) {
-			const Symbol& mtsym = mt.GetSymbol(sym);
-			bool use_internet_data =
-				Config::use_internet_m1_data &&
-				mt_period == 1 &&
-				mtsym.IsForex();
-			if (use_internet_data) {
-				RefreshFromHistory(true);
-				RefreshFromHistory(false);
-			} else {
-				RefreshFromHistory(false);
-			}
+			RefreshFromHistory(IsInternetHistory());
 		}
 		RefreshFromAskBid(init_round);
 	}
@@ -192,12 +179,13 @@ void DataBridge::RefreshCommon() {
 		sys.DataTimeAdd(id, tf, utc_time);
 	}
 	
+	int series = corr[0].sym_ids.GetCount();
 	for(int i = counted; i < bars; i++) {
 		Time utc_time = sys.GetTimeMain(tf, i);
 		sys.DataTimeAdd(id, tf, utc_time);
 		
 		double chng_sum = 0.0;
-		for(int j = 0; j < SYM_COUNT; j++) {
+		for(int j = 0; j < series; j++) {
 			int pos = sys.GetShiftFromMain(corr[0].sym_ids[j], tf, i);
 			ConstBuffer& buf = *corr[0].opens[j];
 			if (pos == 0) continue;
@@ -209,7 +197,7 @@ void DataBridge::RefreshCommon() {
 			chng_sum += valu;
 		}
 		
-		chng_sum /= SYM_COUNT;
+		chng_sum /= series;
 		if (!IsFin(chng_sum) || fabs(chng_sum) > 0.1)
 			chng_sum = 0.0;
 		double prev		= open_buf.Get(i-1);
@@ -227,81 +215,53 @@ void DataBridge::RefreshCommon() {
 	ForceSetCounted(open_buf.GetCount());
 }
 
-void DataBridge::ProcessCorrelation(int output) {
+void DataBridge::ProcessCorrelation() {
 	System& sys = GetSystem();
 	int counted = GetCounted();
 	int tf = GetTimeframe();
 	int bars = sys.GetCountMain(tf);
-	
-	ConstBuffer& a			= *corr[0].opens[0];
-	ConstBuffer& b			= *corr[0].opens[output+1];
-	Buffer& buf				=  corr[0].buffer[output];
-	OnlineAverageWindow2& s	=  corr[0].averages[output];
-	
-	if (b.GetCount() == 0) {
-		LOG("CorrelationOscillator error: No data for output " << output);
+	CorrelationUnit& unit = corr[0];
+	int period = unit.period;
+	int series = unit.sym_ids.GetCount();
+	
+	// Missing symbols are kept flat, which gives them zero correlation
+	Vector<bool> has_data;
+	has_data.SetCount(series);
+	for(int j = 0; j < series; j++) {
+		has_data[j] = unit.opens[j]->GetCount() > 0;
+		if (!has_data[j] && j > 0)
+			LOG("CorrelationOscillator error: No data for output " << j-1);
+	}
+	if (!has_data[0])
 		return;
-	}
 	
-	int period = corr[0].period;
-	
-	if (counted < period) {
-		ASSERT(counted == 0);
-		for(int i = 0; i < period; i++) {
-			SetSafetyLimit(i);
-			int posa = sys.GetShiftFromMain(corr[0].sym_ids[0], tf, i);
-			int posb = sys.GetShiftFromMain(corr[0].sym_ids[output+1], tf, i);
-			s.Add(a.Get(posa), b.Get(posb));
+	Vector<double> row;
+	row.SetCount(series, 0.0);
+	auto AddRow = [&](int i) {
+		for(int j = 0; j < series; j++) {
+			if (!has_data[j]) continue;
+			int pos = sys.GetShiftFromMain(unit.sym_ids[j], tf, i);
+			row[j] = unit.opens[j]->Get(pos);
 		}
-		counted = period;
-	}
-	SetSafetyLimit(counted);
+		unit.matrix.Add(row.Begin());
+	};
 	
-	Vector<double> cache_a, cache_b;
-	cache_a.SetCount(period);
-	cache_b.SetCount(period);
-	
-	int cache_offset = 0;
-	for(int i = 1; i < period; i++) {
-		int posa = sys.GetShiftFromMain(corr[0].sym_ids[0], tf, counted - period + i);
-		int posb = sys.GetShiftFromMain(corr[0].sym_ids[output+1], tf, counted - period + i);
-		
-		cache_a[i] = a.Get(posa);
-		cache_b[i] = b.Get(posb);
+	// The window is rebuilt from the preceding bars, so a rewound counted needs no stored state
+	unit.matrix.Clear();
+	int begin = Upp::max(counted, period);
+	for(int i = Upp::max(0, begin - period + 1); i < begin; i++) {
+		SetSafetyLimit(i);
+		AddRow(i);
 	}
 	
-	buf.SetCount(bars);
-	for(int i = counted; i < bars; i++) {
+	for(int j = 0; j < series-1; j++)
+		unit.buffer[j].SetCount(bars);
+	for(int i = begin; i < bars; i++) {
 		SetSafetyLimit(i);
-		
-		int posa = sys.GetShiftFromMain(corr[0].sym_ids[0], tf, i);
-		int posb = sys.GetShiftFromMain(corr[0].sym_ids[output+1], tf, i);
-		
-		double da = a.Get(posa);
-		double db = b.Get(posb);
-		
-		s.Add(da, db);
-		cache_a[cache_offset] = da;
-		cache_b[cache_offset] = db;
-		cache_offset = (cache_offset + 1) % period;
-		
-		double avg1 = s.GetMeanA();
-		double avg2 = s.GetMeanB();
-		double sum1 = 0;
-	    double sumSqr1 = 0;
-	    double sumSqr2 = 0;
-		for(int j = 0; j < period; j++) {
-			double v1 = cache_a[j];
-			double v2 = cache_b[j];
-			sum1 += (v1 - avg1) * (v2 - avg2);
-			sumSqr1 += pow(v1 - avg1, 2.0);
-			sumSqr2 += pow(v2 - avg2, 2.0);
-		}
-    
-		double mul = sumSqr1 * sumSqr2;
-		double correlation_coef = mul != 0.0 ? sum1 / sqrt(mul) : 0;
-		
-		buf.Set(i, correlation_coef);
+		AddRow(i);
+		for(int j = 0; j < series-1; j++)
+			if (has_data[j+1])
+				unit.buffer[j].Set(i, unit.matrix.Get(0, j+1));
 	}
 }
 
@@ -315,10 +275,7 @@ void DataBridge::RefreshCorrelation() {
 	if (counted == bars)
 		return;
 	
-	int k = 0;
-	for(int i = 0; i < SYM_COUNT-1; i++) {
-		ProcessCorrelation(i);
-	}
+	ProcessCorrelation();
 }
 
 void DataBridge::RefreshFromAskBid(bool init_round) {
@@ -405,6 +362,42 @@ void DataBridge::RefreshFromAskBid(bool init_round) {
 	ForceSetCounted(open_buf.GetCount());
 }
 
+// Adds the steps to the median histograms. Usually the steps are within a small range, so they
+// are counted in a flat array first.
+void DataBridge::AddMedianSteps(const Vector<int>& steps) {
+	if (steps.IsEmpty())
+		return;
+	
+	int lo = steps[0], hi = steps[0];
+	for(int i = 1; i < steps.GetCount(); i++) {
+		int step = steps[i];
+		if (step < lo) lo = step;
+		if (step > hi) hi = step;
+	}
+	if (hi > max_value) max_value = hi;
+	if (lo < min_value) min_value = lo;
+	
+	if ((int64)hi - lo >= 0x10000) {
+		for(int i = 0; i < steps.GetCount(); i++) {
+			int step = steps[i];
+			if (step >= 0) median_max_map.GetAdd(step, 0)++;
+			else median_min_map.GetAdd(step, 0)++;
+		}
+		return;
+	}
+	
+	Vector<int> hist;
+	hist.SetCount(hi - lo + 1, 0);
+	for(int i = 0; i < steps.GetCount(); i++)
+		hist[steps[i] - lo]++;
+	for(int i = 0; i < hist.GetCount(); i++) {
+		if (!hist[i]) continue;
+		int step = lo + i;
+		if (step >= 0) median_max_map.GetAdd(step, 0) += hist[i];
+		else median_min_map.GetAdd(step, 0) += hist[i];
+	}
+}
+
 void DataBridge::RefreshMedian() {
 	// Get median values
 	{
@@ -439,19 +432,17 @@ void DataBridge::RefreshMedian() {
 	}
 }
 
-void DataBridge::RefreshFromHistory(bool use_internet_data) {
+// History files of the symbol in the import order. The files are downloaded if needed.
+void DataBridge::FindHistoryFiles(HistoryImport& imp, bool use_internet_data) {
 	DataBridgeCommon& common = Single<DataBridgeCommon>();
 	common.DownloadHistory(GetSymbol(), GetTf(), false);
 	
-	MetaTrader& mt = GetMetaTrader();
 	System& sys = GetSystem();
 	
 	LOG(Format("sym=%d tf=%d pos=%d", Core::GetSymbol(), GetTimeframe(), GetBars()));
 	
 	
 	// Open data-file
-	int id = GetSymbol();
-	int tf = GetTf();
 	int mt_period = GetPeriod();
 	String symbol = sys.GetSymbol(GetSymbol());
 	String history_dir = ConfigFile("history");
@@ -462,11 +453,9 @@ void DataBridge::RefreshFromHistory(bool use_internet_data) {
 		throw DataExc();
 	}
 	
-	bool old_filetype = false;
-	
 	if (use_internet_data) {
-		System& sys = GetSystem();
-		String symbol = sys.GetSymbol(GetSymbol());
+		String history_file = local_history_file;
+		bool old_filetype = false;
 		
 		String url = "http://tools.fxdd.com/tools/M1Data/" + symbol + ".zip";
 		
@@ -501,7 +490,7 @@ void DataBridge::RefreshFromHistory(bool use_internet_data) {
 					String dst = AppendFileName(data_dir, fname);
 					FileOut fout(dst);
 					fout << unzip.ReadFile();
-					local_history_file = dst;
+					history_file = dst;
 					old_filetype = true;
 					found = true;
 					LOG("Found file " << dst);
@@ -512,133 +501,201 @@ void DataBridge::RefreshFromHistory(bool use_internet_data) {
 			}
 			if (!found) {LOG("History file not found for " + symbol);}
 		} else {
-			local_history_file = local_hst;
+			history_file = local_hst;
 			old_filetype = true;
 		}
+		
+		imp.files.Add(MakeTuple(history_file, old_filetype));
 	}
 	
-	FileIn src(local_history_file);
-	if (!src.IsOpen() || !src.GetSize())
-		return;
-	
-	// Read the history file
-	int digits;
-	src.Seek(4+64+12+4);
-	src.Get(&digits, 4);
-	if (digits > 20)
-		throw DataExc();
-	double point = 1.0 / pow(10.0, digits);
-	common.points[GetSymbol()] = point;
-	int data_size = (int)src.GetSize();
-	int struct_size = 8 + 4*8 + 8 + 4 + 8;
-	if (old_filetype) struct_size = 4 + 4*8 + 8;
-	byte row[0x100];
-	
-	Buffer& open_buf = GetBuffer(0);
-	Buffer& low_buf = GetBuffer(1);
-	Buffer& high_buf = GetBuffer(2);
-	Buffer& volume_buf = GetBuffer(3);
-	
-	// Seek to begin of the data
-	int cursor = (4+64+12+4+4+4+4 +13*4);
-	int expected_count = (int)((src.GetSize() - cursor) / struct_size);
-	src.Seek(cursor);
-	
-	open_buf.Reserve(expected_count);
-	low_buf.Reserve(expected_count);
-	high_buf.Reserve(expected_count);
-	volume_buf.Reserve(expected_count);
+	imp.files.Add(MakeTuple(local_history_file, false));
+}
+
+// Same as System::DataTimeAdd for the private time vector
+static int AddHistoryTime(Vector<Time>& time, const Time& utc_time) {
+	if (time.IsEmpty() || time.Top() < utc_time) {
+		time.Add(utc_time);
+		return time.GetCount() - 1;
+	}
+	for(int i = time.GetCount()-1; i >= 0; i--) {
+		const Time& t = time[i];
+		if (t == utc_time)
+			return i;
+		if (t < utc_time)
+			break;
+	}
+	return -1;
+}
+
+// Reads the history files to the private buffers of the import. This doesn't touch the shared
+// time axis, so several symbols can be parsed at the same time.
+void DataBridge::ParseHistory(HistoryImport& imp) {
+	System& sys = GetSystem();
+	int64 step = GetMinutePeriod() * 60;
+	Time epoch = sys.TimeFromBroker(Time(1970,1,1));
+	Time end = sys.GetEnd();
 	
-	bool overwrite = false;
-	double prev_open = 0.0;
+	HstColumns cols;
+	for(int f = 0; f < imp.files.GetCount(); f++) {
+		HstReader hst;
+		if (!hst.Open(imp.files[f].a, imp.files[f].b))
+			continue;
+		if (!hst.IsHeaderValid())
+			throw DataExc();
+		
+		double point = hst.GetPoint();
+		imp.point = point;
+		imp.opened++;
+		
+		int expected_count = imp.open.GetCount() + (int)hst.GetCount();
+		imp.time.Reserve(expected_count);
+		imp.open.Reserve(expected_count);
+		imp.low.Reserve(expected_count);
+		imp.high.Reserve(expected_count);
+		imp.volume.Reserve(expected_count);
+		imp.steps.Reserve(imp.steps.GetCount() + (int)hst.GetCount());
+		
+		// Read the history file a block at a time
+		for(int64 begin = 0; begin < hst.GetCount(); begin += cols.GetCount()) {
+			int count = hst.Read(begin, HST_BLOCK, cols);
+			HstReader::AlignTime(cols.time.Begin(), count, step);
+			
+			bool finished = false;
+			for(int i = 0; i < count; i++) {
+				Time utc_time = epoch + cols.time[i];
+				if (utc_time >= end) {finished = true; break;}
+				
+				int shift = AddHistoryTime(imp.time, utc_time);
+				if (shift == -1) {imp.rejected.Add(utc_time); finished = true; break;}
+				
+				if (shift >= imp.open.GetCount()) {
+					imp.open.SetCount(shift+1, 0.0);
+					imp.low.SetCount(shift+1, 0.0);
+					imp.high.SetCount(shift+1, 0.0);
+					imp.volume.SetCount(shift+1, 0.0);
+				}
+				
+				imp.open[shift] = cols.open[i];
+				imp.low[shift] = cols.low[i];
+				imp.high[shift] = cols.high[i];
+				imp.volume[shift] = cols.volume[i];
+				
+				int bufcount = imp.open.GetCount();
+				double diff = bufcount >= 2 ? imp.open[bufcount-1] - imp.open[bufcount-2] : 0.0;
+				imp.steps.Add((int)(diff / point));
+			}
+			
+			if (finished || !count) break;
+		}
+	}
+	Sort(imp.rejected);
+}
+
+// Moves the parsed history to the output buffers. The times must be in the system already.
+void DataBridge::ApplyHistory(HistoryImport& imp) {
+	DataBridgeCommon& common = Single<DataBridgeCommon>();
+	common.points[GetSymbol()] = imp.point;
 	
-	if (!GetCounted()) sys.DataTimeBegin(id, tf);
 	ASSERT(!GetCounted());
-	ASSERT(open_buf.GetCount() == 0);
+	int count = imp.open.GetCount();
+	SetSafetyLimit(count);
+	const Vector<double>* src[4] = {&imp.open, &imp.low, &imp.high, &imp.volume};
+	for(int i = 0; i < 4; i++) {
+		Buffer& buf = GetBuffer(i);
+		buf.SetCount(count);
+		if (count)
+			memcpy(buf.BeginWrite(0), src[i]->Begin(), sizeof(double) * count);
+	}
 	
-	int64 step = GetMinutePeriod() * 60;
+	AddMedianSteps(imp.steps);
+	RefreshMedian();
 	
-	while ((cursor + struct_size) <= data_size) {
-		if ((open_buf.GetCount() % 10) == 0) {
-			GetSystem().WhenSubProgress(open_buf.GetCount(), bars*2);
-		}
-		
-		int64 time;
-		double open, high, low, close;
-		int64 tick_volume, real_volume;
-		int spread;
-		src.Get(row, struct_size);
-		byte* current = row;
-		
-		//TODO: endian swap in big endian machines
-		
-		if (!old_filetype) {
-			time  = *((uint64*)current);			current += 8;
-			open  = *((double*)current);			current += 8;
-			high  = *((double*)current);			current += 8;
-			low   = *((double*)current);			current += 8;
-			close = *((double*)current);			current += 8;
-			tick_volume  = *((int64*)current);		current += 8;
-			spread       = *((int32*)current);		current += 4;
-			real_volume  = *((int64*)current);		current += 8;
-		} else {
-			time  = *((int64*)current);				current += 4;
-			open  = *((double*)current);			current += 8;
-			high  = *((double*)current);			current += 8;
-			low   = *((double*)current);			current += 8;
-			close = *((double*)current);			current += 8;
-			tick_volume  = *((double*)current);		current += 8;
-			spread       = 0;
-			real_volume  = 0;
-		}
-		
-		time += 4*24*60*60;
-		time = time - time % step;
-		time -= 4*24*60*60;
-		
-		Time utc_time = sys.TimeFromBroker(Time(1970,1,1) + time);
-		if (utc_time >= sys.GetEnd()) break;
-		
-		cursor += struct_size;
-		int shift = sys.DataTimeAdd(id, tf, utc_time);
-		if (shift == -1) break;
-		
-		if (shift >= open_buf.GetCount()) {
-			open_buf.SetCount(shift+1);
-			low_buf.SetCount(shift+1);
-			high_buf.SetCount(shift+1);
-			volume_buf.SetCount(shift+1);
-		}
-		SetSafetyLimit(shift+1);
-		
-		
-		//ASSERT(bs.GetTime(tf, count) == TimeFromTimestamp(time));
-		open_buf.Set(shift, open);
-		low_buf.Set(shift, low);
-		high_buf.Set(shift, high);
-		volume_buf.Set(shift, tick_volume);
-		
-		
-		int count = open_buf.GetCount();
-		double diff = count >= 2 ? open_buf.Get(count-1) - open_buf.Get(count-2) : 0.0;
-		int step = (int)(diff / point);
-		if (step >= 0) median_max_map.GetAdd(step, 0)++;
-		else median_min_map.GetAdd(step, 0)++;
-		if (step > max_value) max_value = step;
-		if (step < min_value) min_value = step;
-		
-		//LOG(Format("%d: %d %f %f %f %f %d %d %d", cursor, (int)time, open, high, low, close, tick_volume, spread, real_volume));
+	ForceSetCounted(count);
+}
+
+bool DataBridge::IsHistoryImport() {
+	int sym = GetSymbol();
+	System& sys = GetSystem();
+	if (sym == sys.GetAccountSymbol() || sym == sys.GetCommonSymbol())
+		return false;
+	#if ONLY_M1_SOURCE
+	if (GetPeriod() > 1)
+		return false;
+	#endif
+	return sym < GetDataBridgeCommon().GetSymbolCount() && GetCounted() == 0;
+}
+
+bool DataBridge::IsInternetHistory() {
+	const Symbol& mtsym = GetMetaTrader().GetSymbol(GetSymbol());
+	return Config::use_internet_m1_data && GetPeriod() == 1 && mtsym.IsForex();
+}
+
+bool DataBridge::BeginHistoryImport() {
+	GetDataBridgeCommon().InspectInit();
+	if (!IsHistoryImport())
+		return false;
+	
+	history.Create();
+	try {
+		FindHistoryFiles(*history, IsInternetHistory());
+	}
+	catch (Exc e) {
+		history->error = e;
+		history->failed = true;
+	}
+	return true;
+}
+
+void DataBridge::ParseHistoryImport() {
+	if (history.IsEmpty() || history->failed)
+		return;
+	try {
+		ParseHistory(*history);
+	}
+	catch (Exc e) {
+		history->error = e;
+		history->failed = true;
 	}
+}
+
+void DataBridge::GetHistoryTime(Vector<DataTimeSource>& src) {
+	if (history.IsEmpty() || history->failed || !history->opened)
+		return;
+	DataTimeSource& s = src.Add();
+	s.sym = GetSymbol();
+	s.tf = GetTf();
+	s.time = &history->time;
+	s.main_only = &history->rejected;
+	history->merged = true;
+}
+
+void DataBridge::RefreshFromHistory(bool use_internet_data) {
+	System& sys = GetSystem();
 	
-	sys.DataTimeEnd(id, tf);
+	// Parse now if the history wasn't imported with the other symbols
+	if (history.IsEmpty()) {
+		history.Create();
+		FindHistoryFiles(*history, use_internet_data);
+		ParseHistory(*history);
+	}
+	One<HistoryImport> imp = pick(history);
 	
-	RefreshMedian();
+	if (imp->failed)
+		throw DataExc(imp->error);
+	if (!imp->opened)
+		return;
 	
-	// Fill volume querytable
-	bool five_mins = GetMinutePeriod() < 5;
-	int steps = five_mins ? 5 : 1;
+	if (!imp->merged) {
+		Vector<DataTimeSource> src;
+		DataTimeSource& s = src.Add();
+		s.sym = GetSymbol();
+		s.tf = GetTf();
+		s.time = &imp->time;
+		s.main_only = &imp->rejected;
+		sys.DataTimeMerge(src);
+	}
 	
-	ForceSetCounted(open_buf.GetCount());
+	ApplyHistory(*imp);
 }
 
 int DataBridge::GetChangeStep(int shift, int steps) {
@@ -744,6 +801,9 @@ void DataBridge::Assist(int cursor, VectorBool& vec) {
 	}
 	
 	
+	// The scans below stop as soon as the length reaches the limit of the flags, which keeps
+	// them from walking back to the first bar.
+	
 	// Open/Close trend
 	{
 		int dir = 0;
@@ -753,6 +813,7 @@ void DataBridge::Assist(int cursor, VectorBool& vec) {
 			if (dir != 0 && idir != dir) break;
 			dir = idir;
 			len++;
+			if (len > 1) break;
 		}
 		if (len > 1) {
 			if (dir == +1)
@@ -771,6 +832,7 @@ void DataBridge::Assist(int cursor, VectorBool& vec) {
 			if (dir != 0 && idir != dir) break;
 			dir = idir;
 			len++;
+			if (len > 1) break;
 		}
 		if (len > 1) {
 			if (dir == +1)
@@ -789,6 +851,7 @@ void DataBridge::Assist(int cursor, VectorBool& vec) {
 			if (dir != 0 && idir != dir) break;
 			dir = idir;
 			len++;
+			if (len > 1) break;
 		}
 		if (len > 1) {
 			if (dir == +1)
@@ -813,6 +876,7 @@ void DataBridge::Assist(int cursor, VectorBool& vec) {
 			if (dir != 0 && !is_less) break;
 			dir = 1;
 			len++;
+			if (len > 1) break;
 		}
 		if (len > 1)
 			vec.Set(DB_SIDEWAYSTREND, true);
@@ -828,6 +892,7 @@ void DataBridge::Assist(int cursor, VectorBool& vec) {
 			if (dir != 0 && idir != +1) break;
 			dir = idir;
 			len++;
+			if (len > 32) break;
 		}
 		if (len > 1)
 			vec.Set(DB_HIGHBREAK, true);
@@ -845,6 +910,7 @@ void DataBridge::Assist(int cursor, VectorBool& vec) {
 			if (dir != 0 && idir != +1) break;
 			dir = idir;
 			len++;
+			if (len > 32) break;
 		}
 		if (len > 1)
 			vec.Set(DB_LOWBREAK, true);
@@ -60,20 +60,36 @@ struct AskBid : Moveable<AskBid> {
 	double ask, bid;
 };
 
+// History of a symbol parsed into private buffers before it's added to the system
+struct HistoryImport {
+	Vector<Tuple2<String, bool> > files; // path and old file format
+	Vector<Time> time;
+	Vector<Time> rejected; // out-of-order times, which go only to the main time
+	Vector<double> open, low, high, volume;
+	Vector<int> steps;
+	String error;
+	double point = 0;
+	int opened = 0;
+	bool failed = false;
+	bool merged = false;
+};
+
 struct CorrelationUnit : Moveable<CorrelationUnit> {
 	int period;
 	Vector<int> sym_ids;
-	Vector<OnlineAverageWindow2> averages;
 	Vector<Buffer> buffer;
 	
 	Vector<ConstBuffer*> opens;
+	CorrelationMatrix matrix;
 	
-	void Serialize(Stream& s) {s % period % sym_ids % averages % buffer;}
+	void Serialize(Stream& s) {s % period % sym_ids % buffer;}
 };
 
 class DataBridge : public BarData {
 	
 protected:
+	enum {HST_BLOCK = 4096};
+	
 	friend class CommonForce;
 	
 	VectorMap<int,int> median_max_map, median_min_map;
@@ -81,6 +97,7 @@ protected:
 	Vector<Vector<byte> > ext_data;
 	Vector<Vector<int> > sym_group_stats, sym_groups;
 	Vector<CorrelationUnit> corr;
+	One<HistoryImport> history;
 	double spread_mean;
 	int spread_count;
 	int median_max, median_min;
@@ -90,13 +107,19 @@ protected:
 	bool once = true;
 	
 	void RefreshFromHistory(bool use_internet_data);
+	void FindHistoryFiles(HistoryImport& imp, bool use_internet_data);
+	void ParseHistory(HistoryImport& imp);
+	void ApplyHistory(HistoryImport& imp);
+	bool IsHistoryImport();
+	bool IsInternetHistory();
 	void RefreshFromInternet();
 	void RefreshFromAskBid(bool init_round);
 	void RefreshMedian();
+	void AddMedianSteps(const Vector<int>& steps);
 	void RefreshAccount();
 	void RefreshCommon();
 	void RefreshCorrelation();
-	void ProcessCorrelation(int output);
+	void ProcessCorrelation();
 	
 public:
 	typedef DataBridge CLASSNAME;
@@ -130,6 +153,11 @@ public:
 	void AddSpread(double a);
 	void RefreshFromFaster();
 	
+	// Parallel import of the history files, see System::ImportHistory
+	bool BeginHistoryImport();
+	void ParseHistoryImport();
+	void GetHistoryTime(Vector<DataTimeSource>& src);
+	
 	static bool FilterFunction(void* basesystem, int in_sym, int in_tf, int out_sym, int out_tf) {
 		
 		// NOTE: breaks a lot of stuff
@@ -491,6 +491,7 @@ void HistoryCenter::Data() {
 	System& sys = GetSystem();
 	Core* core = sys.CreateSingle(0, sym, tf_id);
 	if (!core) return;
+	core->Pin();
 	
 	Output& out = core->GetOutput(0);
 	const Buffer& open  = out.buffers[0];
@@ -514,6 +515,7 @@ void HistoryCenter::Data() {
 		data_list.Set(i, 3, low.Get(pos));
 		data_list.Set(i, 4, vol.Get(pos));
 	}
+	core->Unpin();
 	
 	sb.SetTotal(count);
 	sb.SetPage(screen_count);
@@ -0,0 +1,103 @@
+#include "Overlook.h"
+
+namespace Overlook {
+
+// The files are little endian
+static inline double PeekDoubleLE(const byte* src) {
+	uint64 bits = Peek64le(src);
+	double d;
+	memcpy(&d, &bits, sizeof(double));
+	return d;
+}
+
+bool HstReader::Open(const char* path, bool old_format) {
+	Close();
+	
+	if (!map.Open(path))
+		return false;
+	int64 size = map.GetFileSize();
+	if (size <= 0 || !map.Map(0, (size_t)size)) {
+		map.Close();
+		return false;
+	}
+	data = map.Begin();
+	
+	this->old_format = old_format;
+	record_size = old_format ? OLD_RECORD_SIZE : RECORD_SIZE;
+	
+	// int version, char copyright[64], char symbol[12], int period, int digits, ...
+	if (size >= HEADER_SIZE) {
+		version = Peek32le(data);
+		digits = Peek32le(data + 4 + 64 + 12 + 4);
+		header_valid = digits >= 0 && digits <= 20;
+	}
+	if (header_valid)
+		count = (size - HEADER_SIZE) / record_size;
+	
+	return true;
+}
+
+void HstReader::Close() {
+	if (data) {
+		map.Unmap();
+		map.Close();
+	}
+	data = NULL;
+	count = 0;
+	version = 0;
+	digits = 0;
+	header_valid = false;
+}
+
+int HstReader::Read(int64 begin, int n, HstColumns& cols) const {
+	n = (int)max<int64>(0, min<int64>(n, count - begin));
+	cols.time.SetCount(n);
+	cols.open.SetCount(n);
+	cols.high.SetCount(n);
+	cols.low.SetCount(n);
+	cols.close.SetCount(n);
+	cols.volume.SetCount(n);
+	
+	const byte* src = data + HEADER_SIZE + begin * record_size;
+	int64* time = cols.time.Begin();
+	double* open = cols.open.Begin();
+	double* high = cols.high.Begin();
+	double* low = cols.low.Begin();
+	double* close = cols.close.Begin();
+	double* volume = cols.volume.Begin();
+	
+	if (!old_format) {
+		// int64 time, double open, high, low, close, int64 tick_volume, int spread, int64 real_volume
+		for(int i = 0; i < n; i++, src += RECORD_SIZE) {
+			time[i]		= Peek64le(src);
+			open[i]		= PeekDoubleLE(src + 8);
+			high[i]		= PeekDoubleLE(src + 16);
+			low[i]		= PeekDoubleLE(src + 24);
+			close[i]	= PeekDoubleLE(src + 32);
+			volume[i]	= (double)(int64)Peek64le(src + 40);
+		}
+	}
+	else {
+		// int time, double open, high, low, close, volume
+		for(int i = 0; i < n; i++, src += OLD_RECORD_SIZE) {
+			time[i]		= (int32)Peek32le(src);
+			open[i]		= PeekDoubleLE(src + 4);
+			high[i]		= PeekDoubleLE(src + 12);
+			low[i]		= PeekDoubleLE(src + 20);
+			close[i]	= PeekDoubleLE(src + 28);
+			volume[i]	= (double)(int64)PeekDoubleLE(src + 36);
+		}
+	}
+	
+	return n;
+}
+
+void HstReader::AlignTime(int64* time, int n, int64 step) {
+	const int64 monday = 4*24*60*60;
+	for(int i = 0; i < n; i++) {
+		int64 t = time[i] + monday;
+		time[i] = t - t % step - monday;
+	}
+}
+
+}
@@ -0,0 +1,55 @@
+#ifndef _Overlook_HstReader_h_
+#define _Overlook_HstReader_h_
+
+namespace Overlook {
+using namespace Upp;
+
+// Decoded records of a history file, one array per field
+struct HstColumns {
+	Vector<int64> time;
+	Vector<double> open, high, low, close, volume;
+	
+	int GetCount() const {return time.GetCount();}
+};
+
+// Reader of the MetaTrader 4 history files (.hst). The file is memory mapped and the header is
+// checked once when opening. The fixed size records are decoded a block at a time into
+// HstColumns. The old format has 44 byte records with 32-bit times and the new format has
+// 60 byte records.
+class HstReader {
+	FileMapping map;
+	const byte* data = NULL;
+	int64 count = 0;
+	int record_size = 0;
+	int version = 0;
+	int digits = 0;
+	bool old_format = false;
+	bool header_valid = false;
+	
+public:
+	enum {HEADER_SIZE = 148, RECORD_SIZE = 60, OLD_RECORD_SIZE = 44};
+	
+	HstReader() {}
+	~HstReader() {Close();}
+	
+	bool Open(const char* path, bool old_format);
+	void Close();
+	
+	// Decodes the records begin...begin + n - 1 and returns the number of them
+	int Read(int64 begin, int n, HstColumns& cols) const;
+	
+	bool   IsOpen() const {return data;}
+	bool   IsHeaderValid() const {return header_valid;}
+	int64  GetCount() const {return count;}
+	int    GetVersion() const {return version;}
+	int    GetDigits() const {return digits;}
+	double GetPoint() const {return 1.0 / pow(10.0, digits);}
+	
+	// Rounds the times down to the begin of their period. The periods are aligned to monday
+	// like in the rest of the system.
+	static void AlignTime(int64* time, int n, int64 step);
+};
+
+}
+
+#endif
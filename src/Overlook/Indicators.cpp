@@ -5,8 +5,9 @@ namespace Overlook {
 double SimpleMA ( const int position, const int period, ConstBuffer& value ) {
 	double result = 0.0;
 	if ( position >= period && period > 0 ) {
+		ConstDouble* v = value.Begin() + position - period + 1;
 		for ( int i = 0; i < period; i++)
-			result += value.Get( position - i );
+			result += v[i];
 		result /= period;
 	}
 	return ( result );
@@ -40,37 +41,43 @@ double LinearWeightedMA ( const int position, const int period, ConstBuffer& val
 	double result = 0.0, sum = 0.0;
 	int    i, wsum = 0;
 	if ( position >= period - 1 && period > 0 ) {
-		for ( i = period;i > 0;i-- ) {
-			wsum += i;
-			sum += value.Get( position - i + 1 ) * ( period - i + 1 );
+		ConstDouble* v = value.Begin() + position - period + 1;
+		for ( i = 0; i < period; i++ ) {
+			wsum += i + 1;
+			sum += v[i] * ( i + 1 );
 		}
 		result = sum / wsum;
 	}
 	return ( result );
 }
 
+void SimpleMAOnRange ( const int begin, const int end, const int period, ConstBuffer& value, Buffer& buffer ) {
+	if ( period <= 0 || begin >= end )
+		return;
+	double* dst = buffer.BeginWrite(begin);
+	int first = Upp::min(Upp::max(begin, period), end);
+	for ( int i = begin; i < first; i++ )
+		dst[i] = 0.0;
+	SmaKernel(value.Begin() + first, dst + first, end - first, period);
+}
+
 
 int SimpleMAOnBuffer ( const int rates_total, const int prev_calculated, const int begin,
 		const int period, ConstBuffer& value, Buffer& buffer ) {
 	int i, limit;
 	if ( period <= 1 || rates_total - begin < period )
 		return ( 0 );
+	limit = period + begin - 1;
 	if ( prev_calculated == 0 ) {
-		limit = period + begin;
-		for ( i = 0;i < limit - 1;i++ )
-			buffer.Set( i, 0.0 );
-		double first_value = 0;
-		for ( i = begin; i < limit;i++ )
-			first_value += value.Get(i);
-		first_value /= period;
-		buffer.Set( limit - 1, first_value);
+		double* dst = buffer.BeginWrite(0);
+		for ( i = 0;i < limit;i++ )
+			dst[i] = 0.0;
 	}
 	else
-		limit = prev_calculated - 1;
-	
-	for ( i = limit; i < rates_total; i++)
-		buffer.Set( i, buffer.Get( i - 1 ) + ( value.Get(i) - value.Get( i - period ) ) / period );
+		limit = Upp::max(limit, prev_calculated - 1);
 	
+	double* dst = buffer.BeginWrite(limit);
+	SmaKernel(value.Begin() + limit, dst + limit, rates_total - limit, period);
 	return ( rates_total );
 }
 
@@ -83,17 +90,16 @@ int ExponentialMAOnBuffer ( const int rates_total, const int prev_calculated, co
 	double dSmoothFactor = 2.0 / ( 1.0 + period );
 	if ( prev_calculated == 0 )
 	{
-		limit = period + begin;
+		double* dst = buffer.BeginWrite(0);
 		for ( i = 0;i < begin;i++ )
-			buffer.Set( i, 0.0 );
-		buffer.Set( begin, value.Get( begin ) );
-		for ( i = begin + 1;i < limit;i++ )
-			buffer.Set( i, value.Get(i) * dSmoothFactor + buffer.Get( i - 1 ) * ( 1.0 - dSmoothFactor ) );
+			dst[i] = 0.0;
+		dst[begin] = value.Get( begin );
+		limit = begin + 1;
 	}
 	else
-		limit = prev_calculated - 1;
-	for ( i = limit;i < rates_total;i++ )
-		buffer.Set( i, value.Get(i) * dSmoothFactor + buffer.Get( i - 1 ) * ( 1.0 - dSmoothFactor ) );
+		limit = Upp::max(begin + 1, prev_calculated - 1);
+	double* dst = buffer.BeginWrite(limit);
+	EmaKernel(value.Begin() + limit, dst + limit, rates_total - limit, dSmoothFactor, dst[limit - 1]);
 	return ( rates_total );
 }
 
@@ -101,33 +107,20 @@ int ExponentialMAOnBuffer ( const int rates_total, const int prev_calculated, co
 int LinearWeightedMAOnBuffer ( const int rates_total, const int prev_calculated, const int begin,
 	const int period, ConstBuffer& value, Buffer& buffer, int &weightsum ) {
 	int        i, limit;
-	double     sum;
 	if ( period <= 1 || rates_total - begin < period )
 		return ( 0 );
+	weightsum = period * (period + 1) / 2;
+	limit = period + begin - 1;
 	if ( prev_calculated == 0 )
 	{
-		weightsum = 0;
-		limit = period + begin;
+		double* dst = buffer.BeginWrite(0);
 		for ( i = 0;i < limit;i++ )
-			buffer.Set( i, 0.0 );
-		double first_value = 0;
-		for ( i = begin;i < limit; i++) {
-			int k = i - begin + 1;
-			weightsum += k;
-			first_value += k * value.Get(i);
-		}
-		first_value /= ( double ) weightsum;
-		buffer.Set( limit - 1, first_value );
+			dst[i] = 0.0;
 	}
 	else
-		limit = prev_calculated - 1;
-	for ( i = limit;i < rates_total; i++)
-	{
-		sum = 0;
-		for ( int j = 0;j < period;j++ )
-			sum += ( period - j ) * value.Get( i - j );
-		buffer.Set( i, sum / weightsum );
-	}
+		limit = Upp::max(limit, prev_calculated - 1);
+	double* dst = buffer.BeginWrite(limit);
+	LwmaKernel(value.Begin() + limit, dst + limit, rates_total - limit, period);
 	return ( rates_total );
 }
 
@@ -138,20 +131,18 @@ int SmoothedMAOnBuffer ( const int rates_total, const int prev_calculated, const
 	int i, limit;
 	if ( period <= 1 || rates_total - begin < period )
 		return ( 0 );
+	limit = period + begin - 1;
 	if ( prev_calculated == 0 ) {
-		limit = period + begin;
-		for ( i = 0;i < limit - 1;i++ )
-			buffer.Set( i, 0.0 );
-		double first_value = 0;
-		for ( i = begin;i < limit;i++ )
-			first_value += value.Get(i);
-		first_value /= period;
-		buffer.Set( limit - 1, first_value );
+		double* dst = buffer.BeginWrite(0);
+		for ( i = 0;i < limit;i++ )
+			dst[i] = 0.0;
+		SmaKernel(value.Begin() + limit, dst + limit, 1, period);
+		limit++;
 	}
 	else
-		limit = prev_calculated - 1;
-	for ( i = limit;i < rates_total; i++)
-		buffer.Set( i, ( buffer.Get( i - 1 ) * ( period - 1 ) + value.Get(i) ) / period );
+		limit = Upp::max(limit + 1, prev_calculated - 1);
+	double* dst = buffer.BeginWrite(limit);
+	EmaKernel(value.Begin() + limit, dst + limit, rates_total - limit, 1.0 / period, dst[limit - 1]);
 	return rates_total;
 }
 
@@ -238,20 +229,12 @@ void MovingAverage::Start() {
 void MovingAverage::Simple()
 {
 	Buffer& buffer = GetBuffer(0);
-	double sum = 0;
 	int bars = GetBars();
 	int pos = ma_counted;
 	if (pos < ma_period) pos = ma_period;
-	SetSafetyLimit(pos);
-	for (int i = 1; i < ma_period; i++)
-		sum += Open(pos - i);
-	while (pos < bars) {
-		SetSafetyLimit(pos);
-		sum += Open( pos );
-		buffer.Set(pos, sum / ma_period);
-		sum -= Open( pos - ma_period + 1 );
-		pos++;
-	}
+	SetSafetyLimit(bars - 1);
+	if (pos < bars)
+		SmaKernel(OpenBegin() + pos, buffer.BeginWrite(pos) + pos, bars - pos, ma_period);
 	if (ma_counted < 1)
 		for (int i = 0; i < ma_period; i++)
 			buffer.Set(i, 0);
@@ -265,70 +248,48 @@ void MovingAverage::Exponential()
 	int pos = 1;
 	if ( ma_counted > 2 )
 		pos = ma_counted + 1;
-	while (pos < bars) {
-		SetSafetyLimit(pos);
-		if (pos == 1)
-			buffer.Set(pos-1, Open(pos - 1));
-		buffer.Set(pos, Open(pos) * pr + buffer.Get(pos-1) * ( 1 - pr ));
-		pos++;
-	}
+	if (pos >= bars)
+		return;
+	SetSafetyLimit(bars - 1);
+	if (pos == 1)
+		buffer.Set(0, Open(0));
+	double* dst = buffer.BeginWrite(pos);
+	EmaKernel(OpenBegin() + pos, dst + pos, bars - pos, pr, dst[pos-1]);
 }
 
 void MovingAverage::Smoothed()
 {
 	Buffer& buffer = GetBuffer(0);
-	double sum = 0;
 	int bars = GetBars();
 	int pos = ma_period;
 	if (pos < ma_counted)
 		pos = ma_counted;
-	while (pos < bars) {
-		SetSafetyLimit(pos);
-		if (pos == ma_period) {
-			for (int i = 0, k = pos; i < ma_period; i++, k--) {
-				sum += Open(k);
-				buffer.Set(k, 0);
-			}
-		}
-		else
-			sum = buffer.Get(pos-1) * ( ma_period - 1 ) + Open(pos);
-		buffer.Set(pos, sum / ma_period);
+	if (pos >= bars)
+		return;
+	SetSafetyLimit(bars - 1);
+	ConstDouble* open = OpenBegin();
+	double* dst = buffer.BeginWrite(pos == ma_period ? 1 : pos);
+	if (pos == ma_period) {
+		for (int k = 1; k < pos; k++)
+			dst[k] = 0;
+		SmaKernel(open + pos, dst + pos, 1, ma_period);
 		pos++;
 	}
+	EmaKernel(open + pos, dst + pos, bars - pos, 1.0 / ma_period, dst[pos-1]);
 }
 
 void MovingAverage::LinearlyWeighted()
 {
 	Buffer& buffer = GetBuffer(0);
-	double sum = 0.0, lsum = 0.0;
-	double value;
 	int bars = GetBars();
-	int weight = 0, pos = ma_counted + 1;
+	int pos = ma_counted + 1;
 	if (pos > bars - ma_period)
 		pos = bars - ma_period;
-	for (int i = 1; i <= ma_period; i++, pos++) {
-		SetSafetyLimit(pos);
-		value = Open( pos );
-		sum += value * i;
-		lsum += value;
-		weight += i;
-	}
-	pos--;
-	int i = pos - ma_period;
-	while (pos < bars) {
-		buffer.Set(pos, sum / weight);
-		pos++;
-		i++;
-		if ( pos == bars )
-			break;
-		SetSafetyLimit(pos);
-		value = Open(pos);
-		sum = sum - lsum + value * ma_period;
-		lsum -= Open(i);
-		lsum += value;
-	}
+	pos += ma_period - 1;
+	SetSafetyLimit(bars - 1);
+	LwmaKernel(OpenBegin() + pos, buffer.BeginWrite(pos) + pos, bars - pos, ma_period);
 	if ( ma_counted < 1 )
-		for (i = 0; i < ma_period; i++)
+		for (int i = 0; i < ma_period; i++)
 			buffer.Set(i, 0);
 }
 
@@ -344,6 +305,130 @@ void MovingAverage::LinearlyWeighted()
 
 
 
+MovingAverageSweep::MovingAverageSweep() {
+	ma_method = MODE_SIMPLE;
+	first_period = 5;
+	last_period = 200;
+	period_step = 1;
+}
+
+void MovingAverageSweep::Init() {
+	if (first_period < 2) first_period = 2;
+	if (period_step < 1) period_step = 1;
+	if (last_period < first_period) last_period = first_period;
+	
+	periods.Clear();
+	for(int p = first_period; p <= last_period; p += period_step)
+		periods.Add(p);
+	
+	// The buffer count depends on the arguments, so the output is sized here
+	Output& out = outputs[0];
+	out.buffers.SetCount(periods.GetCount());
+	out.visible = periods.GetCount();
+	RefreshBuffers();
+	
+	for(int i = 0; i < periods.GetCount(); i++) {
+		SetBufferColor(i, RainbowColor((double)i / max(1, periods.GetCount() - 1)));
+		SetBufferBegin(i, ma_method == MODE_EXPONENTIAL ? 0 : periods[i]);
+	}
+}
+
+void MovingAverageSweep::Start() {
+	int bars = GetBars();
+	if (bars <= periods.Top() + 1)
+		throw DataExc();
+	int counted = GetCounted();
+	if (counted > 0)
+		counted--;
+	
+	SetSafetyLimit(bars - 1);
+	switch (ma_method) {
+		case MODE_SIMPLE:
+		case MODE_LINWEIGHT:
+			Windowed(counted);
+			break;
+		case MODE_EXPONENTIAL:
+			Exponential(counted);
+			break;
+		case MODE_SMOOTHED:
+			Smoothed(counted);
+	}
+}
+
+void MovingAverageSweep::Windowed(int counted) {
+	int bars = GetBars();
+	int rows = periods.GetCount();
+	int pos = max(counted, periods.Top());
+	ConstDouble* open = OpenBegin();
+	bool lwma = ma_method == MODE_LINWEIGHT;
+	
+	// Bars before the longest window are done row by row, the rest in one pass
+	Vector<double*> dst;
+	dst.SetCount(rows);
+	for(int r = 0; r < rows; r++) {
+		int period = periods[r];
+		int begin = max(counted, period);
+		double* d = GetBuffer(r).BeginWrite(counted);
+		for(int i = counted; i < period; i++)
+			d[i] = 0;
+		if (begin < pos) {
+			if (lwma)	LwmaKernel(open + begin, d + begin, pos - begin, period);
+			else		SmaKernel(open + begin, d + begin, pos - begin, period);
+		}
+		dst[r] = d + pos;
+	}
+	if (lwma)	LwmaSweepKernel(open + pos, dst.Begin(), bars - pos, periods.Begin(), rows);
+	else		SmaSweepKernel(open + pos, dst.Begin(), bars - pos, periods.Begin(), rows);
+}
+
+void MovingAverageSweep::Exponential(int counted) {
+	int bars = GetBars();
+	int rows = periods.GetCount();
+	int pos = max(counted, 1);
+	ConstDouble* open = OpenBegin();
+	
+	Vector<double*> dst;
+	Vector<double> k;
+	dst.SetCount(rows);
+	k.SetCount(rows);
+	for(int r = 0; r < rows; r++) {
+		double* d = GetBuffer(r).BeginWrite(pos == 1 ? 0 : pos);
+		if (pos == 1)
+			d[0] = open[0];
+		dst[r] = d + pos;
+		k[r] = 2.0 / (periods[r] + 1);
+	}
+	EmaSweepKernel(open + pos, dst.Begin(), bars - pos, k.Begin(), rows);
+}
+
+void MovingAverageSweep::Smoothed(int counted) {
+	int bars = GetBars();
+	int rows = periods.GetCount();
+	int pos = max(counted, periods.Top() + 1);
+	ConstDouble* open = OpenBegin();
+	
+	// Each row is seeded with the simple average at its period and smoothed from there
+	Vector<double*> dst;
+	Vector<double> k;
+	dst.SetCount(rows);
+	k.SetCount(rows);
+	for(int r = 0; r < rows; r++) {
+		int period = periods[r];
+		int begin = max(counted, period + 1);
+		double* d = GetBuffer(r).BeginWrite(counted);
+		if (counted <= period) {
+			for(int i = counted; i < period; i++)
+				d[i] = 0;
+			SmaKernel(open + period, d + period, 1, period);
+		}
+		k[r] = 1.0 / period;
+		if (begin < pos)
+			EmaKernel(open + begin, d + begin, pos - begin, k[r], d[begin - 1]);
+		dst[r] = d + pos;
+	}
+	EmaSweepKernel(open + pos, dst.Begin(), bars - pos, k.Begin(), rows);
+}
+
 MovingAverageConvergenceDivergence::MovingAverageConvergenceDivergence() {
 	fast_ema_period = 12;
 	slow_ema_period = 26;
@@ -546,6 +631,7 @@ BollingerBands::BollingerBands()
 
 void BollingerBands::Init() {
 	SetCoreChartWindow();
+	SetAllowRewind();
 	
 	bands_deviation = deviation * 0.1;
 	
@@ -601,10 +687,19 @@ void BollingerBands::Start() {
 	
 	ConstBuffer& open = GetInputBuffer(0, 0);
 	
+	RollingDeviation dev;
+	dev.SetPeriod(bands_period);
+	SetSafetyLimit(pos);
+	for (int i = Upp::max(0, pos - bands_period + 1); i < pos; i++)
+		dev.Add(Open(i));
+	
+	SetSafetyLimit(bars - 1);
+	SimpleMAOnRange(pos, bars, bands_period, open, ml_buffer);
+	
 	for ( int i = pos; i < bars; i++) {
 		SetSafetyLimit(i);
-		ml_buffer.Set(i, SimpleMA( i, bands_period, open ));
-		stddev_buffer.Set(i, StdDev_Func ( i, ml_buffer, bands_period ));
+		dev.Add(Open(i));
+		stddev_buffer.Set(i, i < bands_period ? 0.0 : dev.GetStdDev(ml_buffer.Get(i)));
 		tl_buffer.Set(i, ml_buffer.Get(i) + bands_deviation * stddev_buffer.Get(i));
 		bl_buffer.Set(i, ml_buffer.Get(i) - bands_deviation * stddev_buffer.Get(i));
 	}
@@ -621,27 +716,6 @@ void BollingerBands::Assist(int cursor, VectorBool& vec) {
 	}
 }
 
-double BollingerBands::StdDev_Func ( int position, const Buffer& MAvalue, int period ) {
-	double tmp = 0.0;
-
-	if ( position < period )
-		return tmp;
-	
-	int bars = GetBars();
-	for (int i = 0; i < period; i++) {
-		double value = Open (position - i );
-		tmp += pow ( value - MAvalue.Get( position ), 2 );
-	}
-
-	tmp = sqrt( tmp / period );
-
-	return tmp;
-}
-
-
-
-
-
 Envelopes::Envelopes() {
 	ma_period = 14;
 	ma_shift = 0;
@@ -899,6 +973,7 @@ StandardDeviation::StandardDeviation() {
 
 void StandardDeviation::Init() {
 	SetCoreSeparateWindow();
+	SetAllowRewind();
 	SetCoreMinimum(0);
 	
 	SetBufferColor(0, Blue);
@@ -921,7 +996,6 @@ void StandardDeviation::Assist(int cursor, VectorBool& vec) {
 
 void StandardDeviation::Start() {
 	Buffer& stddev_buffer = GetBuffer(0);
-	double value, amount, ma;
 
 	int bars = GetBars();
 	if ( bars <= period )
@@ -936,17 +1010,16 @@ void StandardDeviation::Start() {
 	
 	ConstBuffer& ma_buf = At(0).GetBuffer(0);
 	
+	RollingDeviation dev;
+	dev.SetPeriod(period);
+	SetSafetyLimit(counted);
+	for (int i = Upp::max(0, counted - period + 1); i < counted; i++)
+		dev.Add(Open(i));
+	
 	for (int i = counted; i < bars; i++) {
 		SetSafetyLimit(i);
-		amount = 0.0;
-		ma = ma_buf.Get(i);
-
-		for ( int j = 0; j < period; j++ ) {
-			value = Open( i - j );
-			amount += ( value - ma ) * ( value - ma );
-		}
-
-		stddev_buffer.Set(i, sqrt ( amount / period ));
+		dev.Add(Open(i));
+		stddev_buffer.Set(i, dev.GetStdDev(ma_buf.Get(i)));
 	}
 }
 
@@ -1236,8 +1309,8 @@ void CommodityChannelIndex::Start() {
 		double l = Low(i-1);
 		double c = Open(i);
 		value_buffer.Set(i, ( h + l + c ) / 3);
-		mov_buffer.Set(i, SimpleMA ( i, period, value_buffer ));
 	}
+	SimpleMAOnRange(pos, bars, period, value_buffer, mov_buffer);
 
 	mul = 0.015 / period;
 	pos = period - 1;
@@ -1362,11 +1435,21 @@ void DeMarker::Start() {
 			buffer.Set(bars - i, 0.0);
 
 	
+	// Averages of the range [first, bars), zero before the first full window
+	int first = Upp::max(counted, period);
+	Vector<double> max_av, min_av;
+	max_av.SetCount(bars - counted, 0.0);
+	min_av.SetCount(bars - counted, 0.0);
+	if (first < bars) {
+		SmaKernel(max_buffer.Begin() + first, max_av.Begin() + first - counted, bars - first, period);
+		SmaKernel(min_buffer.Begin() + first, min_av.Begin() + first - counted, bars - first, period);
+	}
+	
 	for (int i = counted; i < bars; i++)
 	{
 		SetSafetyLimit(i);
-		double maxvalue = SimpleMA ( i, period, max_buffer );
-		num = maxvalue + SimpleMA ( i, period, min_buffer );
+		double maxvalue = max_av[i - counted];
+		num = maxvalue + min_av[i - counted];
 
 		if ( num != 0.0 )
 			buffer.Set(i, maxvalue / num - 0.5);  // normalized
@@ -1851,6 +1934,7 @@ StochasticOscillator::StochasticOscillator() {
 
 void StochasticOscillator::Init() {
 	SetCoreSeparateWindow();
+	SetAllowRewind();
 	SetCoreMinimum(-1.0); // normalized
 	SetCoreMaximum(+1.0);  // normalized
 	SetBufferColor(0, LightSeaGreen);
@@ -1909,45 +1993,21 @@ void StochasticOscillator::Start() {
 		}
 	}
 
-	int low_length = k_period;
-	int high_length = k_period;
-	double dmin = 1000000.0;
-	double dmax = -1000000.0;
+	SlidingMin lowest(k_period);
+	SlidingMax highest(k_period);
+	SetSafetyLimit(start);
+	for (int k = start - k_period; k < start - 1; k++) {
+		lowest.Add(k, Low( k ));
+		highest.Add(k, High( k ));
+	}
 	for (int i = start; i < bars; i++) {
 		SetSafetyLimit(i);
-
-		if (low_length >= k_period) {
-			dmin = 1000000.0;
-			for (int k = i - k_period; k < i; k++) {
-				double low = Low( k );
-				if ( dmin > low )
-					dmin = low;
-			}
-			low_length = 0;
-		} else {
-			low_length++;
-			double low = Low( i - 1 );
-			if ( dmin > low )
-				dmin = low;
-		}
 		
-		if (high_length >= k_period) {
-			dmax = -1000000.0;
-			for (int k = i - k_period; k < i; k++) {
-				double high = High( k );
-				if ( dmax < high )
-					dmax = high;
-			}
-			high_length = 0;
-		} else {
-			high_length++;
-			double high = High( i - 1 );
-			if ( dmax < high )
-				dmax = high;
-		}
-
-		low_buffer.Set(i, dmin);
-		high_buffer.Set(i, dmax);
+		lowest.Add(i - 1, Low( i - 1 ));
+		highest.Add(i - 1, High( i - 1 ));
+		
+		low_buffer.Set(i, lowest.Get());
+		high_buffer.Set(i, highest.Get());
 	}
 
 	start = k_period - 1 + slowing - 1;
@@ -2030,6 +2090,7 @@ WilliamsPercentRange::WilliamsPercentRange()
 
 void WilliamsPercentRange::Init() {
 	SetCoreSeparateWindow();
+	SetAllowRewind();
 	SetCoreMinimum(-1); // normalized
 	SetCoreMaximum(+1);  // normalized
 	SetBufferColor(0, DodgerBlue);
@@ -2056,13 +2117,21 @@ void WilliamsPercentRange::Start() {
 		buffer.Set(0, 0);
 	}
 	
+	SlidingMax highest(period);
+	SlidingMin lowest(period);
+	SetSafetyLimit(counted);
+	for (int i = Upp::max(0, counted - period); i < counted - 1; i++) {
+		highest.Add(i, High(i));
+		lowest.Add(i, Low(i));
+	}
+	
 	//bars--;
 	for (int i = counted; i < bars; i++) {
 		SetSafetyLimit(i);
-		int highest = HighestHigh( period, i-1 );
-		int lowest = LowestLow( period, i-1 );
-		double max_high = High( highest );
-		double min_low = Low( lowest );
+		highest.Add(i-1, High( i-1 ));
+		lowest.Add(i-1, Low( i-1 ));
+		double max_high = highest.Get();
+		double min_low = lowest.Get();
 		double close = Open( i );
 		double cur = -2 * ( max_high - close ) / ( max_high - min_low ) + 1;
 		buffer.Set(i, cur); // normalized
@@ -2876,8 +2945,8 @@ void FractalOsc::Start() {
 		if ( v > 1) v = 1;
 		else if ( v < 0) v = 0;
 		buf.Set(i, v - 0.5); // normalized
-		av.Set(i, SimpleMA( i, smoothing_period, buf ));
 	}
+	SimpleMAOnRange(counted, bars, smoothing_period, buf, av);
 }
 
 
@@ -3492,6 +3561,7 @@ SupportResistance::SupportResistance() {
 
 void SupportResistance::Init() {
 	SetCoreChartWindow();
+	SetAllowRewind();
 	SetBufferColor(0, Red);
 	SetBufferColor(1, Green);
 }
@@ -3514,17 +3584,53 @@ void SupportResistance::Start() {
 	else counted++;
 	//bars--;
 	
-	Vector<int> crosses;
+	// Price levels are quantized to points on a grid fixed over the whole history, so that
+	// the histogram of the window can be updated by adding and removing one bar at a time.
+	ConstDouble* low_begin = LowBegin();
+	ConstDouble* high_begin = HighBegin();
+	int begin = Upp::max(0, counted - period - 1);
+	double min_price = DBL_MAX, max_price = -DBL_MAX;
+	for(int j = begin; j < bars - 1; j++) {
+		min_price = Upp::min(min_price, low_begin[j]);
+		max_price = Upp::max(max_price, high_begin[j]);
+	}
+	if (min_price > max_price) return;
+	double quantum = point;
+	while ((max_price - min_price) / quantum > (1 << 22))
+		quantum *= 10;
+	int64 base_level = (int64)floor(min_price / quantum + 0.5);
+	auto Level = [&](double price) {return (int)((int64)floor(price / quantum + 0.5) - base_level);};
+	RangeHistogram hist;
+	hist.SetLevels(Level(max_price) + 1);
+	
+	SlidingMax highest(period);
+	SlidingMin lowest(period);
+	SetSafetyLimit(counted);
+	for (int i = Upp::max(0, counted - period); i < counted - 1; i++) {
+		highest.Add(i, High(i));
+		lowest.Add(i, Low(i));
+	}
+	
+	// The first bar leaves the histogram at i = counted, so it starts one bar earlier
+	for (int i = begin; i < counted - 1; i++)
+		hist.Add(Level(Low(i)), Level(High(i)));
+	
 	for (int i = counted; i < bars; i++) {
 		SetSafetyLimit(i);
 		
-		int highest = HighestHigh(period, i-1);
-		int lowest  = LowestLow(period, i-1);
-		double highesthigh = High(highest);
-		double lowestlow   = Low(lowest);
+		double prev_high = High(i-1), prev_low = Low(i-1);
+		highest.Add(i-1, prev_high);
+		lowest.Add(i-1, prev_low);
+		hist.Add(Level(prev_low), Level(prev_high));
+		int leaving = i - 1 - period;
+		if (leaving >= 0)
+			hist.Remove(Level(Low(leaving)), Level(High(leaving)));
+		double highesthigh = highest.Get();
+		double lowestlow   = lowest.Get();
+		int low_level = Level(lowestlow);
 		
-		int count = (int)((highesthigh - lowestlow) / point + 1);
-		double inc = point;
+		int count = Level(highesthigh) - low_level + 1;
+		double inc = quantum;
 		int inc_points = 1;
 		while (count > 1000) {
 			count /= 10;
@@ -3532,36 +3638,22 @@ void SupportResistance::Start() {
 			inc_points *= 10;
 		}
 		
-		if (crosses.GetCount() < count) crosses.SetCount(count);
+		// Bars crossing the levels of bin j
+		auto crosses = [&](int j) {
+			int level = low_level + j * inc_points;
+			return hist.Get(level, level + inc_points - 1);
+		};
 		
-		for(int j = 0; j < count; j++)
-			crosses[j] = 0;
-		
-		for(int j = i - period; j < i ; j++) {
-			if (j < 0) continue;
-			double high = High(j);
-			double low  = Low(j);
-			
-			int low_pos  = (int)((low  - lowestlow) / inc);
-			int high_pos = (int)((high - lowestlow) / inc);
-			if (high_pos >= count) high_pos = count - 1;
-			
-			for(int k = low_pos; k <= high_pos; k++) {
-				crosses[k]++;
-			}
-		}
-		
-		double close = Open(i);
-		int value_pos = (int)((close  - lowestlow) / inc);
+		int value_pos = (Level(Open(i)) - low_level) / inc_points;
 		if (value_pos >= count) value_pos = count - 1;
 		if (value_pos < 0) value_pos = 0;
 		
 		// Find support
 		int max = 0;
 		int max_pos = value_pos;
-		int max_cross_count = crosses[value_pos];
+		int max_cross_count = crosses(value_pos);
 		for(int j = value_pos - 1; j >= 0; j--) {
-			int cross_count = crosses[j];
+			int cross_count = crosses(j);
 			if (cross_count > max) {
 				max = cross_count;
 				max_pos = j;
@@ -3578,9 +3670,9 @@ void SupportResistance::Start() {
 		// Find resistance
 		max = 0;
 		max_pos = value_pos;
-		max_cross_count = crosses[value_pos];
+		max_cross_count = crosses(value_pos);
 		for(int j = value_pos + 1; j < count; j++) {
-			int cross_count = crosses[j];
+			int cross_count = crosses(j);
 			if (cross_count > max) {
 				max = cross_count;
 				max_pos = j;
@@ -3880,11 +3972,11 @@ void CorrelationOscillator::Init() {
 	}
 	
 	opens.SetCount(SYM_COUNT-1, 0);
-	averages.SetCount(SYM_COUNT-1);
+	corrs.SetCount(SYM_COUNT-1);
 	for(int i = 0; i < SYM_COUNT-1; i++) {
 		ConstBuffer& open = GetInputBuffer(0, sym_ids[i], GetTimeframe(), 0);
 		opens[i] = &open;
-		averages[i].SetPeriod(period);
+		corrs[i].SetPeriod(period);
 	}
 	this_open = &GetInputBuffer(0, GetSymbol(), GetTimeframe(), 0);
 }
@@ -3900,68 +3992,25 @@ void CorrelationOscillator::Process(int id, int output) {
 	
 	Buffer& buf = GetBuffer(output);
 	
-	OnlineAverageWindow2& s = averages[output];
+	RollingCorrelation& c = corrs[output];
 	
 	if (b.GetCount() == 0) {
 		LOG("CorrelationOscillator error: No data for symbol " << GetSystem().GetSymbol(id));
 		return;
 	}
 	
-	if (counted < period) {
-		ASSERT(counted == 0);
-		for(int i = 0; i < period; i++) {
-			SetSafetyLimit(i);
-			int posa = i;
-			int posb = sys.GetShiftFromMain(id, tf, i);
-			s.Add(a.Get(posa), b.Get(posb));
-		}
-		counted = period;
-	}
-	SetSafetyLimit(counted);
-	
-	Vector<double> cache_a, cache_b;
-	cache_a.SetCount(period);
-	cache_b.SetCount(period);
-	
-	int cache_offset = 0;
-	for(int i = 1; i < period; i++) {
-		int posa = counted - period + i;
-		int posb = sys.GetShiftFromMain(id, tf, posa);
-		cache_a[i] = a.Get(posa);
-		cache_b[i] = b.Get(posb);
-	}
-	
-	for(int i = counted; i < bars; i++) {
+	// Warm up the window from the bars before counted
+	c.Clear();
+	int begin = Upp::max(counted, period);
+	for(int i = Upp::max(0, begin - period + 1); i < bars; i++) {
 		SetSafetyLimit(i);
 		
 		int posa = i;
 		int posb = sys.GetShiftFromMain(id, tf, posa);
+		c.Add(a.Get(posa), b.Get(posb));
 		
-		double da = a.Get(posa);
-		double db = b.Get(posb);
-		
-		s.Add(da, db);
-		cache_a[cache_offset] = da;
-		cache_b[cache_offset] = db;
-		cache_offset = (cache_offset + 1) % period;
-		
-		double avg1 = s.GetMeanA();
-		double avg2 = s.GetMeanB();
-		double sum1 = 0;
-	    double sumSqr1 = 0;
-	    double sumSqr2 = 0;
-		for(int j = 0; j < period; j++) {
-			double v1 = cache_a[j];
-			double v2 = cache_b[j];
-			sum1 += (v1 - avg1) * (v2 - avg2);
-			sumSqr1 += pow(v1 - avg1, 2.0);
-			sumSqr2 += pow(v2 - avg2, 2.0);
-		}
-    
-		double mul = sumSqr1 * sumSqr2;
-		double correlation_coef = mul != 0.0 ? sum1 / sqrt(mul) : 0;
-		
-		buf.Set(i, correlation_coef);
+		if (i >= begin)
+			buf.Set(i, c.Get());
 	}
 }
 
@@ -13,6 +13,7 @@ double SimpleMA ( const int position, const int period, ConstBuffer& value );
 double ExponentialMA ( const int position, const int period, const double prev_value, ConstBuffer& value );
 double SmoothedMA ( const int position, const int period, const double prev_value, ConstBuffer& value );
 double LinearWeightedMA ( const int position, const int period, ConstBuffer& value );
+void SimpleMAOnRange ( const int begin, const int end, const int period, ConstBuffer& value, Buffer& buffer );
 int SimpleMAOnBuffer ( const int rates_total, const int prev_calculated, const int begin, const int period, ConstBuffer& value, Buffer& buffer );
 int ExponentialMAOnBuffer ( const int rates_total, const int prev_calculated, const int begin, const int period, ConstBuffer& value, Buffer& buffer );
 int LinearWeightedMAOnBuffer ( const int rates_total, const int prev_calculated, const int begin, const int period, ConstBuffer& value, Buffer& buffer, int &weightsum );
@@ -53,6 +54,40 @@ public:
 };
 
 
+// Moving averages of a range of periods in one core. Buffer r holds the average of
+// GetSweepPeriod(r), so the output is a period x bar matrix. The sum based methods share one
+// prefix scan of the source for all periods.
+class MovingAverageSweep : public Core {
+	Vector<int> periods;
+	int ma_method;
+	int first_period, last_period, period_step;
+	
+protected:
+	virtual void Start();
+	
+	void Windowed(int counted);
+	void Exponential(int counted);
+	void Smoothed(int counted);
+	
+public:
+	MovingAverageSweep();
+	
+	virtual void Init();
+	
+	int GetSweepCount() const {return periods.GetCount();}
+	int GetSweepPeriod(int row) const {return periods[row];}
+	
+	virtual void IO(ValueRegister& reg) {
+		reg % In<DataBridge>()
+			% Out(1, 1)
+			% Arg("method", ma_method, 0, 3)
+			% Arg("first_period", first_period, 2)
+			% Arg("last_period", last_period, 2)
+			% Arg("step", period_step, 1);
+	}
+};
+
+
 class MovingAverageConvergenceDivergence : public Core {
 	int fast_ema_period;
 	int slow_ema_period;
@@ -99,8 +134,6 @@ class BollingerBands : public Core {
 	int           plot_begin;
 	int           deviation;
 	
-	double StdDev_Func(int position, const Buffer& MAvalue, int period);
-	
 public:
 	BollingerBands();
 	
@@ -868,7 +901,7 @@ protected:
 	ConstBuffer* this_open;
 	Vector<int> sym_ids;
 	Vector<ConstBuffer*> opens;
-	Vector<OnlineAverageWindow2> averages;
+	Vector<RollingCorrelation> corrs;
 	
 	void Process(int id, int output);
 	
@@ -0,0 +1,506 @@
+#include "Overlook.h"
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+namespace Overlook {
+
+static void ScanScalar(const double* src, double* dst, int count, double shift) {
+	double sum = 0;
+	for(int i = 0; i < count; i++)
+		dst[i] = sum += src[i] - shift;
+}
+
+static void WeightedScanScalar(const double* src, double* dst, int count, double shift) {
+	double sum = 0;
+	for(int i = 0; i < count; i++)
+		dst[i] = sum += (i + 1) * (src[i] - shift);
+}
+
+static void DiffScalar(const double* a, const double* b, double* dst, int count, double shift, double mul) {
+	for(int i = 0; i < count; i++)
+		dst[i] = shift + (a[i] - b[i]) * mul;
+}
+
+static void WeightedDiffScalar(const double* qa, const double* qb, const double* pa, const double* pb, double* dst, int count, double shift, double mul, double first) {
+	for(int i = 0; i < count; i++)
+		dst[i] = shift + ((qa[i] - qb[i]) - (first + i) * (pa[i] - pb[i])) * mul;
+}
+
+static void EmaScalar(const double* src, double* dst, int count, double k, double prev) {
+	double k1 = 1.0 - k;
+	for(int i = 0; i < count; i++)
+		dst[i] = prev = src[i] * k + prev * k1;
+}
+
+static double DotScalar(const double* x, const double* y, int count) {
+	double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	int i = 0;
+	for(; i + 4 <= count; i += 4) {
+		s0 += x[i+0] * y[i+0];
+		s1 += x[i+1] * y[i+1];
+		s2 += x[i+2] * y[i+2];
+		s3 += x[i+3] * y[i+3];
+	}
+	for(; i < count; i++)
+		s0 += x[i] * y[i];
+	return (s0 + s1) + (s2 + s3);
+}
+
+static void AxpyScalar(double a, const double* x, double* y, int count) {
+	for(int i = 0; i < count; i++)
+		y[i] += a * x[i];
+}
+
+
+#ifdef CPU_X86
+
+#ifdef __GNUC__
+#define KERNEL_TARGET(x) __attribute__((target(x)))
+#else
+#define KERNEL_TARGET(x)
+#endif
+
+// Inclusive prefix sum of the lanes: [a, b, c, d] -> [a, a+b, a+b+c, a+b+c+d]
+KERNEL_TARGET("avx2") static inline __m256d Prefix4(__m256d v) {
+	__m256d zero = _mm256_setzero_pd();
+	v = _mm256_add_pd(v, _mm256_blend_pd(_mm256_permute4x64_pd(v, 0x90), zero, 0x1));
+	v = _mm256_add_pd(v, _mm256_blend_pd(_mm256_permute4x64_pd(v, 0x40), zero, 0x3));
+	return v;
+}
+
+KERNEL_TARGET("avx2") static void ScanAvx2(const double* src, double* dst, int count, double shift) {
+	__m256d c = _mm256_set1_pd(shift);
+	__m256d carry = _mm256_setzero_pd();
+	int i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m256d v = _mm256_sub_pd(_mm256_loadu_pd(src + i), c);
+		v = _mm256_add_pd(Prefix4(v), carry);
+		_mm256_storeu_pd(dst + i, v);
+		carry = _mm256_permute4x64_pd(v, 0xFF);
+	}
+	double sum = i ? dst[i-1] : 0;
+	for(; i < count; i++)
+		dst[i] = sum += src[i] - shift;
+}
+
+KERNEL_TARGET("avx2") static void WeightedScanAvx2(const double* src, double* dst, int count, double shift) {
+	__m256d c = _mm256_set1_pd(shift);
+	__m256d w = _mm256_set_pd(4, 3, 2, 1);
+	__m256d step = _mm256_set1_pd(4);
+	__m256d carry = _mm256_setzero_pd();
+	int i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m256d v = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(src + i), c), w);
+		v = _mm256_add_pd(Prefix4(v), carry);
+		_mm256_storeu_pd(dst + i, v);
+		carry = _mm256_permute4x64_pd(v, 0xFF);
+		w = _mm256_add_pd(w, step);
+	}
+	double sum = i ? dst[i-1] : 0;
+	for(; i < count; i++)
+		dst[i] = sum += (i + 1) * (src[i] - shift);
+}
+
+KERNEL_TARGET("avx2") static void DiffAvx2(const double* a, const double* b, double* dst, int count, double shift, double mul) {
+	__m256d s = _mm256_set1_pd(shift);
+	__m256d m = _mm256_set1_pd(mul);
+	int i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m256d d = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+		_mm256_storeu_pd(dst + i, _mm256_add_pd(s, _mm256_mul_pd(d, m)));
+	}
+	for(; i < count; i++)
+		dst[i] = shift + (a[i] - b[i]) * mul;
+}
+
+KERNEL_TARGET("avx2") static void WeightedDiffAvx2(const double* qa, const double* qb, const double* pa, const double* pb, double* dst, int count, double shift, double mul, double first) {
+	__m256d s = _mm256_set1_pd(shift);
+	__m256d m = _mm256_set1_pd(mul);
+	__m256d idx = _mm256_set_pd(first + 3, first + 2, first + 1, first);
+	__m256d step = _mm256_set1_pd(4);
+	int i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m256d q = _mm256_sub_pd(_mm256_loadu_pd(qa + i), _mm256_loadu_pd(qb + i));
+		__m256d p = _mm256_sub_pd(_mm256_loadu_pd(pa + i), _mm256_loadu_pd(pb + i));
+		__m256d w = _mm256_sub_pd(q, _mm256_mul_pd(idx, p));
+		_mm256_storeu_pd(dst + i, _mm256_add_pd(s, _mm256_mul_pd(w, m)));
+		idx = _mm256_add_pd(idx, step);
+	}
+	for(; i < count; i++)
+		dst[i] = shift + ((qa[i] - qb[i]) - (first + i) * (pa[i] - pb[i])) * mul;
+}
+
+// Blocks of 4: y[j] = sum of k * b^(j-m) * x[m] for m <= j, plus b^(j+1) * y[-1]
+KERNEL_TARGET("avx2") static void EmaAvx2(const double* src, double* dst, int count, double k, double prev) {
+	double b = 1.0 - k;
+	__m256d zero = _mm256_setzero_pd();
+	__m256d vk = _mm256_set1_pd(k);
+	__m256d b1 = _mm256_set1_pd(b);
+	__m256d b2 = _mm256_set1_pd(b * b);
+	__m256d pw = _mm256_set_pd(b * b * b * b, b * b * b, b * b, b);
+	__m256d y = _mm256_set1_pd(prev);
+	int i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m256d u = _mm256_mul_pd(_mm256_loadu_pd(src + i), vk);
+		u = _mm256_add_pd(u, _mm256_mul_pd(b1, _mm256_blend_pd(_mm256_permute4x64_pd(u, 0x90), zero, 0x1)));
+		u = _mm256_add_pd(u, _mm256_mul_pd(b2, _mm256_blend_pd(_mm256_permute4x64_pd(u, 0x40), zero, 0x3)));
+		y = _mm256_add_pd(u, _mm256_mul_pd(pw, y));
+		_mm256_storeu_pd(dst + i, y);
+		y = _mm256_permute4x64_pd(y, 0xFF);
+	}
+	double p = i ? dst[i-1] : prev;
+	for(; i < count; i++)
+		dst[i] = p = src[i] * k + p * b;
+}
+
+KERNEL_TARGET("avx2") static double DotAvx2(const double* x, const double* y, int count) {
+	__m256d s0 = _mm256_setzero_pd();
+	__m256d s1 = _mm256_setzero_pd();
+	int i = 0;
+	for(; i + 8 <= count; i += 8) {
+		s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(x + i),     _mm256_loadu_pd(y + i)));
+		s1 = _mm256_add_pd(s1, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+	}
+	double lanes[4];
+	_mm256_storeu_pd(lanes, _mm256_add_pd(s0, s1));
+	double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	for(; i < count; i++)
+		sum += x[i] * y[i];
+	return sum;
+}
+
+KERNEL_TARGET("avx2") static void AxpyAvx2(double a, const double* x, double* y, int count) {
+	__m256d va = _mm256_set1_pd(a);
+	int i = 0;
+	for(; i + 4 <= count; i += 4)
+		_mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(va, _mm256_loadu_pd(x + i))));
+	for(; i < count; i++)
+		y[i] += a * x[i];
+}
+
+KERNEL_TARGET("sse2") static void ScanSse2(const double* src, double* dst, int count, double shift) {
+	__m128d zero = _mm_setzero_pd();
+	__m128d c = _mm_set1_pd(shift);
+	__m128d carry = zero;
+	int i = 0;
+	for(; i + 2 <= count; i += 2) {
+		__m128d v = _mm_sub_pd(_mm_loadu_pd(src + i), c);
+		v = _mm_add_pd(v, _mm_unpacklo_pd(zero, v));
+		v = _mm_add_pd(v, carry);
+		_mm_storeu_pd(dst + i, v);
+		carry = _mm_unpackhi_pd(v, v);
+	}
+	double sum = i ? dst[i-1] : 0;
+	for(; i < count; i++)
+		dst[i] = sum += src[i] - shift;
+}
+
+KERNEL_TARGET("sse2") static void WeightedScanSse2(const double* src, double* dst, int count, double shift) {
+	__m128d zero = _mm_setzero_pd();
+	__m128d c = _mm_set1_pd(shift);
+	__m128d w = _mm_set_pd(2, 1);
+	__m128d step = _mm_set1_pd(2);
+	__m128d carry = zero;
+	int i = 0;
+	for(; i + 2 <= count; i += 2) {
+		__m128d v = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(src + i), c), w);
+		v = _mm_add_pd(v, _mm_unpacklo_pd(zero, v));
+		v = _mm_add_pd(v, carry);
+		_mm_storeu_pd(dst + i, v);
+		carry = _mm_unpackhi_pd(v, v);
+		w = _mm_add_pd(w, step);
+	}
+	double sum = i ? dst[i-1] : 0;
+	for(; i < count; i++)
+		dst[i] = sum += (i + 1) * (src[i] - shift);
+}
+
+KERNEL_TARGET("sse2") static void DiffSse2(const double* a, const double* b, double* dst, int count, double shift, double mul) {
+	__m128d s = _mm_set1_pd(shift);
+	__m128d m = _mm_set1_pd(mul);
+	int i = 0;
+	for(; i + 2 <= count; i += 2) {
+		__m128d d = _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i));
+		_mm_storeu_pd(dst + i, _mm_add_pd(s, _mm_mul_pd(d, m)));
+	}
+	for(; i < count; i++)
+		dst[i] = shift + (a[i] - b[i]) * mul;
+}
+
+KERNEL_TARGET("sse2") static void WeightedDiffSse2(const double* qa, const double* qb, const double* pa, const double* pb, double* dst, int count, double shift, double mul, double first) {
+	__m128d s = _mm_set1_pd(shift);
+	__m128d m = _mm_set1_pd(mul);
+	__m128d idx = _mm_set_pd(first + 1, first);
+	__m128d step = _mm_set1_pd(2);
+	int i = 0;
+	for(; i + 2 <= count; i += 2) {
+		__m128d q = _mm_sub_pd(_mm_loadu_pd(qa + i), _mm_loadu_pd(qb + i));
+		__m128d p = _mm_sub_pd(_mm_loadu_pd(pa + i), _mm_loadu_pd(pb + i));
+		__m128d w = _mm_sub_pd(q, _mm_mul_pd(idx, p));
+		_mm_storeu_pd(dst + i, _mm_add_pd(s, _mm_mul_pd(w, m)));
+		idx = _mm_add_pd(idx, step);
+	}
+	for(; i < count; i++)
+		dst[i] = shift + ((qa[i] - qb[i]) - (first + i) * (pa[i] - pb[i])) * mul;
+}
+
+KERNEL_TARGET("sse2") static void EmaSse2(const double* src, double* dst, int count, double k, double prev) {
+	double b = 1.0 - k;
+	__m128d zero = _mm_setzero_pd();
+	__m128d vk = _mm_set1_pd(k);
+	__m128d b1 = _mm_set1_pd(b);
+	__m128d pw = _mm_set_pd(b * b, b);
+	__m128d y = _mm_set1_pd(prev);
+	int i = 0;
+	for(; i + 2 <= count; i += 2) {
+		__m128d u = _mm_mul_pd(_mm_loadu_pd(src + i), vk);
+		u = _mm_add_pd(u, _mm_mul_pd(b1, _mm_unpacklo_pd(zero, u)));
+		y = _mm_add_pd(u, _mm_mul_pd(pw, y));
+		_mm_storeu_pd(dst + i, y);
+		y = _mm_unpackhi_pd(y, y);
+	}
+	double p = i ? dst[i-1] : prev;
+	for(; i < count; i++)
+		dst[i] = p = src[i] * k + p * b;
+}
+
+KERNEL_TARGET("sse2") static double DotSse2(const double* x, const double* y, int count) {
+	__m128d s0 = _mm_setzero_pd();
+	__m128d s1 = _mm_setzero_pd();
+	int i = 0;
+	for(; i + 4 <= count; i += 4) {
+		s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(x + i),     _mm_loadu_pd(y + i)));
+		s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, _mm_add_pd(s0, s1));
+	double sum = lanes[0] + lanes[1];
+	for(; i < count; i++)
+		sum += x[i] * y[i];
+	return sum;
+}
+
+KERNEL_TARGET("sse2") static void AxpySse2(double a, const double* x, double* y, int count) {
+	__m128d va = _mm_set1_pd(a);
+	int i = 0;
+	for(; i + 2 <= count; i += 2)
+		_mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_loadu_pd(x + i))));
+	for(; i < count; i++)
+		y[i] += a * x[i];
+}
+
+static bool CpuHasAvx2() {
+	#if defined __GNUC__
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+	#elif defined flagMSC
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+	if (!os_saves_ymm)
+		return false;
+	__cpuidex(info, 7, 0);
+	return info[1] & (1 << 5);
+	#else
+	return false;
+	#endif
+}
+
+static bool CpuHasSse2() {
+	#if defined __GNUC__
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+	#else
+	return CpuSSE2();
+	#endif
+}
+
+#endif
+
+
+static const MaKernels& SelectMaKernels() {
+	static const MaKernels scalar = {"scalar", ScanScalar, WeightedScanScalar, DiffScalar, WeightedDiffScalar, EmaScalar};
+	const MaKernels* k = &scalar;
+
+	#ifdef CPU_X86
+	static const MaKernels sse2 = {"sse2", ScanSse2, WeightedScanSse2, DiffSse2, WeightedDiffSse2, EmaSse2};
+	static const MaKernels avx2 = {"avx2", ScanAvx2, WeightedScanAvx2, DiffAvx2, WeightedDiffAvx2, EmaAvx2};
+	if (CpuHasAvx2())
+		k = &avx2;
+	else if (CpuHasSse2())
+		k = &sse2;
+	#endif
+
+	LOG("Moving average kernels: " << k->name);
+	return *k;
+}
+
+const MaKernels& GetMaKernels() {
+	static const MaKernels& k = SelectMaKernels();
+	return k;
+}
+
+static const GemmKernels& SelectGemmKernels() {
+	static const GemmKernels scalar = {"scalar", DotScalar, AxpyScalar};
+	const GemmKernels* k = &scalar;
+
+	#ifdef CPU_X86
+	static const GemmKernels sse2 = {"sse2", DotSse2, AxpySse2};
+	static const GemmKernels avx2 = {"avx2", DotAvx2, AxpyAvx2};
+	if (CpuHasAvx2())
+		k = &avx2;
+	else if (CpuHasSse2())
+		k = &sse2;
+	#endif
+
+	LOG("Matrix kernels: " << k->name);
+	return *k;
+}
+
+const GemmKernels& GetGemmKernels() {
+	static const GemmKernels& k = SelectGemmKernels();
+	return k;
+}
+
+
+// Panels of GEMM_KC x GEMM_NC values of B are reused for all rows of A while they are in the
+// cache.
+enum {GEMM_KC = 256, GEMM_NC = 64};
+
+void GemmNT(const double* a, int lda, const double* b, int ldb, double* c, int ldc, int m, int n, int k) {
+	const GemmKernels& g = GetGemmKernels();
+	for(int p = 0; p < k; p += GEMM_KC) {
+		int kc = min((int)GEMM_KC, k - p);
+		for(int j0 = 0; j0 < n; j0 += GEMM_NC) {
+			int j1 = min(n, j0 + (int)GEMM_NC);
+			for(int i = 0; i < m; i++) {
+				const double* ai = a + i * lda + p;
+				double* ci = c + i * ldc;
+				for(int j = j0; j < j1; j++)
+					ci[j] += g.dot(ai, b + j * ldb + p, kc);
+			}
+		}
+	}
+}
+
+void GemmNN(const double* a, int lda, const double* b, int ldb, double* c, int ldc, int m, int n, int k) {
+	const GemmKernels& g = GetGemmKernels();
+	for(int j = 0; j < n; j += GEMM_KC) {
+		int nc = min((int)GEMM_KC, n - j);
+		for(int i = 0; i < m; i++) {
+			const double* ai = a + i * lda;
+			double* ci = c + i * ldc + j;
+			for(int p = 0; p < k; p++)
+				if (ai[p] != 0.0)
+					g.axpy(ai[p], b + p * ldb + j, ci, nc);
+		}
+	}
+}
+
+void GemmTN(const double* a, int lda, const double* b, int ldb, double* c, int ldc, int m, int n, int k) {
+	const GemmKernels& g = GetGemmKernels();
+	for(int j = 0; j < n; j += GEMM_KC) {
+		int nc = min((int)GEMM_KC, n - j);
+		for(int p = 0; p < k; p++) {
+			const double* ap = a + p * lda;
+			const double* bp = b + p * ldb + j;
+			for(int i = 0; i < m; i++)
+				if (ap[i] != 0.0)
+					g.axpy(ap[i], bp, c + i * ldc + j, nc);
+		}
+	}
+}
+
+
+// The prefix sums are restarted for every block of outputs and taken relative to a value of the
+// block, so their magnitude and rounding error stay small regardless of the series length.
+enum {MA_BLOCK = 1024};
+
+static int GetMaxPeriod(const int* periods, int period_count) {
+	int max_period = 0;
+	for(int i = 0; i < period_count; i++)
+		max_period = max(max_period, periods[i]);
+	return max_period;
+}
+
+void SmaSweepKernel(const double* src, double* const* dst, int count, const int* periods, int period_count) {
+	int max_period = GetMaxPeriod(periods, period_count);
+	if (count <= 0 || max_period <= 0)
+		return;
+
+	const MaKernels& k = GetMaKernels();
+	int block = max((int)MA_BLOCK, 4 * max_period);
+	Vector<double> pre;
+	pre.SetCount(min(block, count) + max_period);
+	pre[0] = 0;
+
+	for(int b = 0; b < count; b += block) {
+		int n = min(block, count - b);
+		const double* s = src + b - max_period + 1;
+		double shift = s[0];
+		k.scan(s, pre.Begin() + 1, n + max_period - 1, shift);
+		for(int r = 0; r < period_count; r++) {
+			int period = periods[r];
+			k.diff(pre.Begin() + max_period, pre.Begin() + max_period - period, dst[r] + b, n, shift, 1.0 / period);
+		}
+	}
+}
+
+// The window of a shorter period starts max_period - period values later in the shared scan, so
+// its weights are offset by that much.
+void LwmaSweepKernel(const double* src, double* const* dst, int count, const int* periods, int period_count) {
+	int max_period = GetMaxPeriod(periods, period_count);
+	if (count <= 0 || max_period <= 0)
+		return;
+
+	const MaKernels& k = GetMaKernels();
+	int block = max((int)MA_BLOCK, 4 * max_period);
+	Vector<double> pre, wpre;
+	pre.SetCount(min(block, count) + max_period);
+	wpre.SetCount(pre.GetCount());
+	pre[0] = 0;
+	wpre[0] = 0;
+
+	for(int b = 0; b < count; b += block) {
+		int n = min(block, count - b);
+		const double* s = src + b - max_period + 1;
+		double shift = s[0];
+		k.scan(s, pre.Begin() + 1, n + max_period - 1, shift);
+		k.weighted_scan(s, wpre.Begin() + 1, n + max_period - 1, shift);
+		for(int r = 0; r < period_count; r++) {
+			int period = periods[r];
+			int first = max_period - period;
+			double mul = 2.0 / ((double)period * (period + 1));
+			k.weighted_diff(wpre.Begin() + max_period, wpre.Begin() + first, pre.Begin() + max_period, pre.Begin() + first, dst[r] + b, n, shift, mul, first);
+		}
+	}
+}
+
+void EmaSweepKernel(const double* src, double* const* dst, int count, const double* k, int row_count) {
+	if (count <= 0)
+		return;
+
+	const MaKernels& kernels = GetMaKernels();
+	for(int b = 0; b < count; b += MA_BLOCK) {
+		int n = min((int)MA_BLOCK, count - b);
+		for(int r = 0; r < row_count; r++) {
+			double* d = dst[r] + b;
+			kernels.ema(src + b, d, n, k[r], d[-1]);
+		}
+	}
+}
+
+void SmaKernel(const double* src, double* dst, int count, int period) {
+	SmaSweepKernel(src, &dst, count, &period, 1);
+}
+
+void LwmaKernel(const double* src, double* dst, int count, int period) {
+	LwmaSweepKernel(src, &dst, count, &period, 1);
+}
+
+}
@@ -0,0 +1,73 @@
+#ifndef _Overlook_Kernels_h_
+#define _Overlook_Kernels_h_
+
+namespace Overlook {
+using namespace Upp;
+
+// Vectorized primitives of the moving average kernels. The best set supported by the cpu is
+// selected at the first use: AVX2, SSE2 or portable scalar code.
+struct MaKernels {
+	const char* name;
+
+	// dst[i] = sum of (src[j] - shift) for j <= i
+	void (*scan)(const double* src, double* dst, int count, double shift);
+
+	// dst[i] = sum of (j + 1) * (src[j] - shift) for j <= i
+	void (*weighted_scan)(const double* src, double* dst, int count, double shift);
+
+	// dst[i] = shift + (a[i] - b[i]) * mul
+	void (*diff)(const double* a, const double* b, double* dst, int count, double shift, double mul);
+
+	// dst[i] = shift + ((qa[i] - qb[i]) - (first + i) * (pa[i] - pb[i])) * mul
+	void (*weighted_diff)(const double* qa, const double* qb, const double* pa, const double* pb, double* dst, int count, double shift, double mul, double first);
+
+	// dst[i] = src[i] * k + dst[i-1] * (1 - k), where dst[-1] is 'prev'
+	void (*ema)(const double* src, double* dst, int count, double k, double prev);
+};
+
+const MaKernels& GetMaKernels();
+
+
+// Moving averages on raw spans. Output j is computed from the window src[j - period + 1]...src[j],
+// so 'src' must be preceded by period - 1 valid values.
+void SmaKernel(const double* src, double* dst, int count, int period);
+void LwmaKernel(const double* src, double* dst, int count, int period);
+
+// The same for several periods at once: dst[r] receives the averages of periods[r]. The prefix
+// sums of a block are shared by all periods, so 'src' must be preceded by max(periods) - 1 values.
+void SmaSweepKernel(const double* src, double* const* dst, int count, const int* periods, int period_count);
+void LwmaSweepKernel(const double* src, double* const* dst, int count, const int* periods, int period_count);
+
+// Exponential smoothing: dst[j] = src[j] * k + dst[j - 1] * (1 - k), where dst[-1] is 'prev'.
+// The smoothed moving average is the same with k = 1 / period.
+inline void EmaKernel(const double* src, double* dst, int count, double k, double prev) {
+	if (count > 0) GetMaKernels().ema(src, dst, count, k, prev);
+}
+
+// Exponential smoothing of several rows with factors k[r]. dst[r][-1] is the previous value of
+// each row. The rows are advanced a block at a time so that the source stays in the cache.
+void EmaSweepKernel(const double* src, double* const* dst, int count, const double* k, int row_count);
+
+
+// Vectorized primitives of the matrix products, selected like MaKernels.
+struct GemmKernels {
+	const char* name;
+
+	// sum of x[i] * y[i]
+	double (*dot)(const double* x, const double* y, int count);
+
+	// y[i] += a * x[i]
+	void (*axpy)(double a, const double* x, double* y, int count);
+};
+
+const GemmKernels& GetGemmKernels();
+
+// Blocked products of row-major matrices. 'm', 'n' and 'k' are the rows and columns of C and
+// the length of the sum, 'lda', 'ldb' and 'ldc' are the row strides. The result is added to C.
+void GemmNT(const double* a, int lda, const double* b, int ldb, double* c, int ldc, int m, int n, int k);	// C += A * B^T
+void GemmNN(const double* a, int lda, const double* b, int ldb, double* c, int ldc, int m, int n, int k);	// C += A * B
+void GemmTN(const double* a, int lda, const double* b, int ldb, double* c, int ldc, int m, int n, int k);	// C += A^T * B
+
+}
+
+#endif
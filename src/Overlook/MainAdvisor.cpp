@@ -16,6 +16,9 @@ void MainAdvisor::Init() {
 	
 	SetCoreSeparateWindow();
 	
+	if (Config::dqn_training_threads > 0)
+		SetTrainingThreads(Config::dqn_training_threads);
+	
 	SetBufferColor(0, RainbowColor(Randomf()));
 	
 	for(int i = 0; i < SYM_COUNT; i++) {
@@ -130,6 +133,11 @@ void MainAdvisor::RefreshAll() {
 	LOG("MainAdvisor::Start ... RefreshOutputBuffers " << ts.ToString());
 	ts.Reset();
 	
+	state_count = Upp::min(state_count, prev_counted);
+	RefreshStates();
+	LOG("MainAdvisor::Start ... RefreshStates " << ts.ToString());
+	ts.Reset();
+	
 	RefreshMain();
 	LOG("MainAdvisor::Start ... RefreshMain " << ts.ToString());
 	
@@ -142,8 +150,10 @@ void MainAdvisor::RefreshAll() {
 void MainAdvisor::RefreshAction(int cursor) {
 	DQN::DQVectorType& before		= data[cursor];
 	
-	LoadState(tmp_before_state, cursor);
-	dqn_trainer.Evaluate(tmp_before_state, before);
+	dqn_trainer.EvaluateBits(GetStateRow(cursor), before);
+	
+	if (cursor < main_dirty)		main_dirty = cursor;
+	if (cursor >= main_dirty_end)	main_dirty_end = cursor + 1;
 }
 
 void MainAdvisor::RefreshReward(int cursor) {
@@ -208,6 +218,16 @@ bool MainAdvisor::TrainingDQNBegin() {
 	
 	dqntraining_pts.SetCount(bars, 0);
 	
+	// The trained weights are useless if the state encoding has changed
+	if (state_version != STATE_VERSION) {
+		dqn_trainer.Reset();
+		dqntraining_pts.Clear();
+		dqntraining_pts.SetCount(bars, 0);
+		dqn_round = 0;
+		dqn_pt_cursor = 0;
+		state_version = STATE_VERSION;
+	}
+	
 	if (dqn_round < 0) {
 		dqn_round = 0;
 	}
@@ -232,6 +252,9 @@ bool MainAdvisor::TrainingDQNBegin() {
 		if (pos > main_begin) main_begin = pos;
 	}
 	
+	RefreshStates();
+	main_count = 0;
+	
 	return true;
 }
 
@@ -248,7 +271,10 @@ bool MainAdvisor::TrainingDQNIterator() {
 	dqn_trainer.SetEpsilon(0);//epsilon);
 	dqn_trainer.SetGamma(0.01);
 	
-	for(int i = 0; i < 10; i++) {
+	// Every thread learns the samples of 10 rounds
+	int threads = GetTrainingThreads();
+	batch_pos.SetCount(0);
+	for(int i = 0; i < 10 * threads; i++) {
 		int cursor = dqn_round % (data.GetCount() - 1);
 		RefreshAction(cursor);
 		RefreshReward(cursor);
@@ -258,15 +284,58 @@ bool MainAdvisor::TrainingDQNIterator() {
 			if (count < 1) break;
 			int pos = min_pos + Random(count);
 			if (pos < 0 || pos >= data.GetCount()) continue;
-			DQN::DQVectorType& before = data[pos];
-			LoadState(tmp_before_state, pos);
-			LoadState(tmp_after_state, pos+1);
-			dqn_trainer.Learn(tmp_before_state, before, tmp_after_state);
+			batch_pos.Add(pos);
 		}
 		
 		dqn_round++;
 	}
 	
+	// The samples are learned in batches of a fixed size, so the steps don't depend on the
+	// thread count
+	int batch_count = batch_pos.GetCount();
+	int task_count = (batch_count + DQN_BATCH - 1) / DQN_BATCH;
+	if (task_count) {
+		batch_rows.SetCount(batch_count);
+		batch_vecs.SetCount(batch_count);
+		GetStateRow(data.GetCount() - 1); // rows must not move while pointers are collected
+		for(int i = 0; i < batch_count; i++) {
+			batch_rows[i] = GetStateRow(batch_pos[i]);
+			batch_vecs[i] = &data[batch_pos[i]];
+		}
+		worker_errors.SetCount(task_count);
+		if (threads <= 1) {
+			for(int i = 0; i < task_count; i++) {
+				int begin = i * DQN_BATCH;
+				int count = Upp::min((int)DQN_BATCH, batch_count - begin);
+				worker_errors[i] = dqn_trainer.LearnBatchBits(batch_rows.Begin() + begin, batch_vecs.Begin() + begin, count);
+			}
+		}
+		else {
+			// Hogwild: the threads update the sparse W1 columns without locking
+			worker_batches.SetCount(task_count);
+			CoWork co;
+			for(int i = 0; i < task_count; i++) {
+				int begin = i * DQN_BATCH;
+				int count = Upp::min((int)DQN_BATCH, batch_count - begin);
+				DQN::Batch* b = &worker_batches[i];
+				double* err = &worker_errors[i];
+				co & [=] {
+					*err = dqn_trainer.LearnBatchBits(*b, batch_rows.Begin() + begin, batch_vecs.Begin() + begin, count);
+				};
+			}
+			co.Finish();
+			
+			// The dense layers are shared by every sample, so their gradients are applied here
+			for(int i = 0; i < task_count; i++)
+				dqn_trainer.UpdateHidden(worker_batches[i]);
+		}
+		
+		double err_sum = 0.0;
+		for(int i = 0; i < task_count; i++)
+			err_sum += worker_errors[i];
+		dqn_trainer.SetTDError(err_sum / task_count);
+	}
+	
 	
 	// This is only for progress drawer...
 	RunMain();
@@ -302,27 +371,41 @@ bool MainAdvisor::TrainingDQNInspect() {
 
 
 
+// The equity curve of the training is kept between calls. Only the bars after the first
+// changed action are evaluated again, until the signals are the same as before. The curve is
+// then rebuilt from the first bar whose change differs, which is only multiplication.
 void MainAdvisor::RunMain() {
 	System& sys = GetSystem();
 	int bars = Upp::min(data.GetCount(), GetBars());
+	if (bars <= 0) return;
 	dqntraining_pts.SetCount(bars, 0.0);
+	main_change.SetCount(bars, 1.0);
+	main_peak.SetCount(bars, 1.0);
+	main_drawdown.SetCount(bars, 0.0);
+	main_state.SetCount(bars, 0);
 	bars--;
 	
-	double change_total = 1.0;
+	if (main_count > bars) main_count = bars;
+	int begin = Upp::max(main_begin, Upp::min(main_dirty, main_count));
+	int changed = main_count;
 	
 	bool prev_signal[SYM_COUNT], prev_enabled[SYM_COUNT];
+	dword state = begin > main_begin ? main_state[begin - 1] : 0;
 	for(int i = 0; i < SYM_COUNT; i++) {
-		prev_signal[i] = 0;
-		prev_enabled[i] = 0;
+		prev_signal[i] = (state >> i) & 1;
+		prev_enabled[i] = (state >> (SYM_COUNT + i)) & 1;
 	}
 	
-	for(int i = 0; i < main_begin; i++)
-		dqntraining_pts[i] = 1.0;
-	
-	for(int i = main_begin; i < bars; i++) {
+	bool same_state = false;
+	int i = begin;
+	for(; i < bars; i++) {
+		if (same_state && i >= main_dirty_end && i < main_count)
+			break;
+		
 		DQN::DQVectorType& current = data[i];
 		double change_sum = 0.0;
 		int open_count = 0;
+		state = 0;
 		for (int j = 0; j < SYM_COUNT; j++) {
 			double long_proximity  = current.weight[j * SYM_BITS + 0];
 			double short_proximity = current.weight[j * SYM_BITS + 1];
@@ -359,14 +442,36 @@ void MainAdvisor::RunMain() {
 			
 			prev_signal[j] = signal;
 			prev_enabled[j] = is_enabled;
+			if (signal)		state |= 1 << j;
+			if (is_enabled)	state |= 1 << (SYM_COUNT + j);
 		}
-		if (open_count) {
-			change_sum /= open_count;
-			change_total	*= 1.0 + change_sum;
-		}
-		dqntraining_pts[i] = change_total;
+		double change = open_count ? 1.0 + change_sum / open_count : 1.0;
+		if (change != main_change[i] && i < changed)
+			changed = i;
+		same_state = state == main_state[i];
+		main_change[i] = change;
+		main_state[i] = state;
+	}
+	main_count = Upp::max(main_count, i);
+	main_dirty = INT_MAX;
+	main_dirty_end = 0;
+	
+	for(int i = changed; i < bars; i++) {
+		double prev_pt   = i > 0 ? dqntraining_pts[i - 1] : 1.0;
+		double prev_peak = i > 0 ? main_peak[i - 1] : 1.0;
+		double prev_dd   = i > 0 ? main_drawdown[i - 1] : 0.0;
+		double pt = prev_pt * main_change[i];
+		double peak = Upp::max(prev_peak, pt);
+		dqntraining_pts[i] = pt;
+		main_peak[i] = peak;
+		main_drawdown[i] = Upp::max(prev_dd, 1.0 - pt / peak);
 	}
-	dqntraining_pts[bars] = change_total;
+	if (bars > 0) {
+		dqntraining_pts[bars] = dqntraining_pts[bars - 1];
+		main_peak[bars] = main_peak[bars - 1];
+		main_drawdown[bars] = main_drawdown[bars - 1];
+	}
+	else dqntraining_pts[0] = 1.0;
 }
 
 void MainAdvisor::RefreshOutputBuffers() {
@@ -393,27 +498,54 @@ void MainAdvisor::RefreshOutputBuffers() {
 	}
 }
 
-void MainAdvisor::LoadState(DQN::MatType& state, int cursor) {
+// The inputs are binary, so the states are kept as bit rows of STATE_WORDS words. A set bit is
+// an input of 1.0. Rows are appended as bars are added and the last one is always recomputed.
+void MainAdvisor::RefreshStates() {
+	int bars = GetBars();
+	int begin = Upp::max(0, state_count - 1);
+	state_rows.SetCount(bars * STATE_WORDS, 0);
+	for(int i = begin; i < bars; i++)
+		ComputeState(state_rows.Begin() + i * STATE_WORDS, i);
+	state_count = bars;
+}
+
+const uint64* MainAdvisor::GetStateRow(int cursor) {
+	SetSafetyLimit(cursor);
+	if (cursor >= state_count)
+		RefreshStates();
+	ASSERT(cursor < state_count);
+	return state_rows.Begin() + cursor * STATE_WORDS;
+}
+
+int MainAdvisor::GetTrainingThreads() const {
+	if (dqn_threads > 0)
+		return dqn_threads;
+	return GetUsedCpuCores();
+}
+
+void MainAdvisor::ComputeState(uint64* row, int cursor) {
 	System& sys = GetSystem();
 	SetSafetyLimit(cursor);
 	
-	int col = 0;
+	for(int i = 0; i < STATE_WORDS; i++)
+		row[i] = 0;
 	
+	#define SET_STATE(i)	row[(i) >> 6] |=  ((uint64)1 << ((i) & 63))
+	
+	int col = 0;
 	
-	// Time bits
-	for(int i = 0; i < 5+24+4; i++)
-		state.Set(col + i, 1.0);
 	
+	// One-hot time bits
 	Time t = GetSystem().GetTimeTf(GetSymbol(), GetTf(), cursor);
 	
-	int wday = Upp::max(0, Upp::min(5, DayOfWeek(t) - 1));
-	state.Set(col + wday, 0.0);
+	int wday = Upp::max(0, Upp::min(4, DayOfWeek(t) - 1));
+	SET_STATE(col + wday);
 	col += 5;
 	
-	state.Set(col + t.hour, 0.0);
+	SET_STATE(col + t.hour);
 	col += 24;
 	
-	state.Set(col + t.minute / 15, 0.0);
+	SET_STATE(col + t.minute / 15);
 	col += 4;
 	
 	
@@ -428,15 +560,16 @@ void MainAdvisor::LoadState(DQN::MatType& state, int cursor) {
 			tmp_assist.Zero();
 			for(int j = 0; j < CORE_COUNT; j++) {
 				CoreIO& cio = *cores[c++];
-				cio.Assist(pos, tmp_assist);
-			}
-			for(int k = 0; k < ASSIST_COUNT; k++) {
-				double value = tmp_assist.Get(k) ? 0.0 : 1.0;
-				state.Set(col++, value);
+				cio.GetAssist(pos, tmp_assist);
 			}
+			for(int k = 0; k < ASSIST_COUNT; k++, col++)
+				if (tmp_assist.Get(k))
+					SET_STATE(col);
 		}
 	}
 	ASSERT(col == INPUT_SIZE);
+	
+	#undef SET_STATE
 }
 
 void MainAdvisor::RefreshMain() {
@@ -465,6 +598,15 @@ void MainAdvisor::TrainingDQNCtrl::Paint(Draw& w) {
 	ASSERT(rfa);
 	DrawVectorPolyline(id, sz, rfa->dqntraining_pts, polyline);
 	
+	if (!rfa->main_drawdown.IsEmpty()) {
+		Font fnt = Monospace(10);
+		String str = Format("max drawdown %.2f%%", rfa->main_drawdown.Top() * 100.0);
+		Size str_sz = GetTextSize(str, fnt);
+		int y = sz.cy - str_sz.cy;
+		id.DrawRect(16, y, str_sz.cx, str_sz.cy, White());
+		id.DrawText(16, y, str, fnt, Black());
+	}
+	
 	w.DrawImage(0, 0, id);
 }
 
@@ -1,6 +1,10 @@
 #ifndef _Overlook_MainAdvisor_h_
 #define _Overlook_MainAdvisor_h_
 
+namespace Config {
+extern Upp::IniInt dqn_training_threads;
+}
+
 namespace Overlook {
 using namespace Upp;
 
@@ -18,8 +22,11 @@ protected:
 	static const int TIME_BITS			= 5 + 24 + 4;
 	static const int INPUT_SIZE			= TIME_BITS + (SYM_COUNT+1) * ASSIST_COUNT * tf_count;
 	static const int OUTPUT_SIZE		= (SYM_COUNT+1) * SYM_BITS * tf_count;
+	static const int STATE_WORDS		= (INPUT_SIZE + 63) / 64;
+	static const int STATE_VERSION		= 1;
 ;
 	static const int CORE_COUNT			= 25;
+	static const int DQN_BATCH			= 10 * 5;
 	
 	static const int check_period1		= 2;
 	static const int check_period2		= 2*4;
@@ -40,19 +47,33 @@ protected:
 	int							dqn_round			= 0;
 	int							dqn_pt_cursor		= 0;
 	int							main_begin = 0;
+	int							state_version = 0;
 	
 	
 	
 	// Temp
 	ConstBuffer*				open_buf[(SYM_COUNT+1) * tf_count];
-	DQN::MatType				tmp_before_state, tmp_after_state;
+	Vector<const uint64*>		batch_rows;
+	Vector<const DQN::DQVectorType*> batch_vecs;
+	Vector<int>					batch_pos;
+	Array<DQN::Batch>			worker_batches;
+	Vector<double>				worker_errors;
 	Vector<CoreIO*>				cores;
+	Vector<uint64>				state_rows;
+	Vector<double>				main_change;
+	Vector<double>				main_peak;
+	Vector<double>				main_drawdown;
+	Vector<dword>				main_state;
 	VectorBool					tmp_assist;
 	SimBroker					sb;
 	int							tf_ids[tf_count];
 	int							tf_step[tf_count];
 	int							tf_div[tf_count];
 	int							prev_counted		= 0;
+	int							state_count			= 0;
+	int							main_count			= 0;
+	int							main_dirty			= INT_MAX;
+	int							main_dirty_end		= 0;
 	int							realtime_count		= 0;
 	double						check_sum1[SYM_COUNT];
 	double						check_sum2[SYM_COUNT];
@@ -64,6 +85,11 @@ protected:
 	#else
 	int							dqn_max_rounds		= 5000000;
 	#endif
+	#ifdef flagDEBUG
+	int							dqn_threads			= 1;
+	#else
+	int							dqn_threads			= 0;
+	#endif
 	
 protected:
 	virtual void Start();
@@ -78,7 +104,10 @@ protected:
 	void RefreshAll();
 	void RefreshAction(int data_pos);
 	void RefreshReward(int data_pos);
-	void LoadState(DQN::MatType& state, int cursor);
+	void RefreshStates();
+	void ComputeState(uint64* row, int cursor);
+	const uint64* GetStateRow(int cursor);
+	int  GetTrainingThreads() const;
 	void MainReal();
 	void RunSimBroker();
 	
@@ -88,6 +117,9 @@ public:
 	
 	virtual void Init();
 	
+	// 0 uses all cores, 1 trains deterministically in the job thread
+	void SetTrainingThreads(int i) {dqn_threads = i;}
+	
 	
 	double GetSpreadPoint(int i) const {return spread_point[i];}
 	
@@ -125,7 +157,8 @@ public:
 			% Mem(dqntraining_pts)
 			% Mem(dqn_round)
 			% Mem(dqn_pt_cursor)
-			% Mem(main_begin);
+			% Mem(main_begin)
+			% Mem(state_version);
 	}
 	
 	static bool FilterFunction1(void* basesystem, int in_sym, int in_tf, int out_sym, int out_tf) {
@@ -498,7 +498,7 @@ void Overlook::RefreshAssist() {
 		
 		Core& core = *ci.core;
 		if (cursor >= core.GetBars()) break;
-		core.Assist(cursor, vec);
+		core.GetAssist(cursor, vec);
 	}
 	
 	int row = 0;
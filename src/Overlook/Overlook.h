@@ -11,13 +11,16 @@ using namespace Upp;
 #include <CtrlCore/lay.h>
 
 #include "Common.h"
+#include "Kernels.h"
 #include "Calendar.h"
 #include "Optimizer.h"
 #include "DQN.h"
 #include "SimBroker.h"
 #include "System.h"
+#include "CoreCache.h"
 #include "Core.h"
 #include "ExposureTester.h"
+#include "HstReader.h"
 #include "DataBridge.h"
 #include "Utils.h"
 #include "Indicators.h"
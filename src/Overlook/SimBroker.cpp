@@ -178,7 +178,18 @@ int		SimBroker::iBars(String symbol, int timeframe) {
 }
 
 int		SimBroker::iBarShift(String symbol, int timeframe, int datetime) {
-	Panic("no need to implement yet"); return 0;
+	System& sys = GetSystem();
+	int sym = sys.FindSymbol(symbol);
+	int tf = sys.FindPeriod(timeframe);
+	if (sym == -1 || tf == -1)
+		return -1;
+	
+	// Shifts are counted from the bar of the simulation time
+	int cur = sys.FindShiftTf(sym, tf, cycle_time);
+	int pos = sys.FindShiftTf(sym, tf, sys.TimeFromBroker(TimeFromTimestamp(datetime)));
+	if (cur == -1 || pos == -1)
+		return -1;
+	return max(0, cur - pos);
 }
 
 double	SimBroker::iClose(String symbol, int timeframe, int shift) {
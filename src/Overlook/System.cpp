@@ -51,6 +51,7 @@ void System::Init() {
 				throw UserExc("MT4 symbols changed. Remove cached data.");
 		}
 	}
+	InitTimeState();
 	InitRegistry();
 	
 	
@@ -197,34 +198,224 @@ void System::Deinit() {
 	StoreThis();
 }
 
+static void PutVarint(Stream& s, uint64 v) {
+	while (v >= 0x80) {
+		s.Put((int)(v & 0x7F) | 0x80);
+		v >>= 7;
+	}
+	s.Put((int)v);
+}
+
+static uint64 GetVarint(Stream& s) {
+	uint64 v = 0;
+	for(int shift = 0; shift < 64; shift += 7) {
+		int c = s.Get();
+		if (c < 0)
+			s.LoadError();
+		v |= (uint64)(c & 0x7F) << shift;
+		if (!(c & 0x80))
+			return v;
+	}
+	s.LoadError();
+	return 0;
+}
+
+// Sorted times are stored as zigzag varint deltas in seconds, which is mostly one byte per bar
+static void SerializeTimeDeltas(Stream& s, Vector<Time>& time) {
+	int count = time.GetCount();
+	s / count;
+	int64 prev = 0;
+	if (s.IsStoring()) {
+		for(int i = 0; i < count; i++) {
+			int64 t = time[i].Get();
+			int64 d = t - prev;
+			PutVarint(s, ((uint64)d << 1) ^ (uint64)(d >> 63));
+			prev = t;
+		}
+	}
+	else {
+		if (count < 0)
+			s.LoadError();
+		time.SetCount(count);
+		for(int i = 0; i < count; i++) {
+			uint64 z = GetVarint(s);
+			prev += (int64)(z >> 1) ^ -(int64)(z & 1);
+			time[i].Set(prev);
+		}
+	}
+}
+
+// The version 1 format stores the time vectors as deltas and leaves out the conversion vectors,
+// which are rebuilt after loading. Files without the magic are read with the old layout.
+void System::Serialize(Stream& s) {
+	int magic = SYSTEMBIN_MAGIC, version = SYSTEMBIN_VERSION;
+	if (s.IsLoading()) {
+		int64 begin = s.GetPos();
+		s % magic;
+		if (magic != SYSTEMBIN_MAGIC) {
+			s.Seek(begin);
+			SerializeLegacy(s);
+			return;
+		}
+		s % version;
+		if (version < 1 || version > SYSTEMBIN_VERSION)
+			s.LoadError();
+	}
+	else s % magic % version;
+	
+	s % symbols % periods % period_strings % priority % spread_points % proxy_id
+	  % proxy_base_mul % sym_priority % time_offset;
+	
+	int sym_count = pos_time.GetCount();
+	int tf_count = main_time.GetCount();
+	s / sym_count / tf_count;
+	if (s.IsLoading()) {
+		if (sym_count < 0 || tf_count < 0)
+			s.LoadError();
+		pos_time		.SetCount(sym_count);
+		posconv_from	.SetCount(sym_count);
+		posconv_to		.SetCount(sym_count);
+		for(int i = 0; i < sym_count; i++) {
+			pos_time[i]		.SetCount(tf_count);
+			posconv_from[i]	.SetCount(tf_count);
+			posconv_to[i]	.SetCount(tf_count);
+		}
+		main_time		.SetCount(tf_count);
+		main_conv		.SetCount(tf_count);
+		for(int i = 0; i < tf_count; i++)
+			main_conv[i].SetCount(tf_count);
+	}
+	
+	Vector<Time> keys;
+	for(int i = 0; i < tf_count; i++) {
+		VectorMap<Time, byte>& main_time = this->main_time[i];
+		if (s.IsStoring()) {
+			keys.SetCount(main_time.GetCount());
+			for(int j = 0; j < keys.GetCount(); j++)
+				keys[j] = main_time.GetKey(j);
+		}
+		SerializeTimeDeltas(s, keys);
+		if (s.IsLoading()) {
+			main_time.Clear();
+			main_time.Reserve(keys.GetCount());
+			for(int j = 0; j < keys.GetCount(); j++)
+				main_time.Add(keys[j], 0);
+		}
+	}
+	for(int i = 0; i < sym_count; i++)
+		for(int j = 0; j < tf_count; j++)
+			SerializeTimeDeltas(s, pos_time[i][j]);
+	
+	if (s.IsLoading())
+		RefreshTimeConversions();
+}
+
+void System::SerializeLegacy(Stream& s) {
+	s % symbols % periods % period_strings % priority % spread_points % proxy_id
+	  % proxy_base_mul % sym_priority % time_offset
+	  % pos_time % main_time % main_conv % posconv_from % posconv_to;
+}
+
+// The loaded time vectors are sorted and their conversion vectors are up to date
+void System::InitTimeState() {
+	int tf_count = main_time.GetCount();
+	main_time_sorted.SetCount(tf_count);
+	main_time_from.SetCount(tf_count);
+	for(int i = 0; i < tf_count; i++) {
+		main_time_sorted[i] = main_time[i].GetCount();
+		main_time_from[i] = INT_MAX;
+	}
+	pos_time_from.SetCount(pos_time.GetCount());
+	for(int i = 0; i < pos_time.GetCount(); i++) {
+		pos_time_from[i].SetCount(0);
+		pos_time_from[i].SetCount(pos_time[i].GetCount(), INT_MAX);
+	}
+	main_time_changed = false;
+	time_store_pending = false;
+	time_stored.Reset();
+}
+
+// Writes the changed time vectors at most once a minute, because the whole system.bin is
+// rewritten. Deinit stores the rest.
+void System::StorePendingTime() {
+	if (time_store_pending && time_stored.Elapsed() >= 60*1000)
+		StoreThis();
+}
+
 void System::DataTimeBegin(int sym, int tf) {
 	Vector<Time>& symtf_pos_time = pos_time[sym][tf];
 	symtf_pos_time.Clear();
+	pos_time_from[sym][tf] = 0;
 }
 
 void System::DataTimeEnd(int sym, int tf) {
-	auto& main_time = this->main_time[tf];
+	int& pos_from = pos_time_from[sym][tf];
 	
-	
-	// If main_time changed, refresh all sym time-vectors
-	bool was_main_time_changed = main_time_changed;
+	// If main_time changed, refresh the tail of all sym time-vectors
 	if (main_time_changed) {
-		SortByKey(main_time, StdLess<Time>());
+		int from = SpliceMainTime(tf);
 		
-		RefreshTimeTfVectors(tf);
+		RefreshTimeTfVectors(tf, from);
 		
 		for(int i = 0; i < symbols.GetCount(); i++)
-			RefreshTimeSymVectors(i, tf);
+			RefreshTimeSymVectors(i, tf, from, i == sym ? pos_from : INT_MAX);
 		
-		StoreThis();
+		time_store_pending = true;
 		main_time_changed = false;
 	}
 	// Else refresh just this sym/tf
 	else {
 		
-		RefreshTimeSymVectors(sym, tf);
+		RefreshTimeSymVectors(sym, tf, INT_MAX, pos_from);
+		
+	}
+	pos_from = INT_MAX;
+}
+
+// Moves the times, which were added before the end of the main time, to their sorted positions.
+// Returns the first changed position.
+int System::SpliceMainTime(int tf) {
+	VectorMap<Time, byte>& main_time = this->main_time[tf];
+	int& sorted = main_time_sorted[tf];
+	int from = main_time_from[tf];
+	int count = main_time.GetCount();
+	
+	if (sorted < count) {
+		Vector<Time> added;
+		added.SetCount(count - sorted);
+		for(int i = sorted; i < count; i++)
+			added[i - sorted] = main_time.GetKey(i);
+		Sort(added, StdLess<Time>());
+		
+		// Lower bound of the earliest added time in the sorted part
+		int pos = 0, end = sorted;
+		while (pos < end) {
+			int mid = (pos + end) / 2;
+			if (main_time.GetKey(mid) < added[0])
+				pos = mid + 1;
+			else
+				end = mid;
+		}
 		
+		Vector<Time> tail;
+		tail.Reserve(count - pos);
+		int a = pos, b = 0;
+		while (a < sorted || b < added.GetCount()) {
+			if (b == added.GetCount() || (a < sorted && main_time.GetKey(a) < added[b]))
+				tail.Add(main_time.GetKey(a++));
+			else
+				tail.Add(added[b++]);
+		}
+		
+		main_time.Trim(pos);
+		for(int i = 0; i < tail.GetCount(); i++)
+			main_time.Add(tail[i], 0);
+		from = min(from, pos);
 	}
+	
+	sorted = main_time.GetCount();
+	main_time_from[tf] = INT_MAX;
+	return from;
 }
 
 int System::DataTimeAdd(int sym, int tf, Time utc_time) {
@@ -232,36 +423,141 @@ int System::DataTimeAdd(int sym, int tf, Time utc_time) {
 	
 	if (utc_time >= end) return -1;
 	
-	int i = main_time.Find(utc_time);
-	if (i == -1) {
-		//if (main_time.IsEmpty() || utc_time <= main_time.Top())
+	// Times after the sorted main time are appended in place without a lookup, other new times
+	// are spliced in the end
+	int count = main_time.GetCount();
+	int& sorted = main_time_sorted[tf];
+	if (sorted == count && (!count || main_time.GetKey(count-1) < utc_time)) {
+		main_time_from[tf] = min(main_time_from[tf], count);
+		sorted++;
+		main_time_changed = true;
+		main_time.Add(utc_time);
+	}
+	else if (main_time.Find(utc_time) == -1) {
 		main_time_changed = true;
 		main_time.Add(utc_time);
 	}
 	
 	Vector<Time>& symtf_pos_time = pos_time[sym][tf];
+	int& pos_from = pos_time_from[sym][tf];
 	if (symtf_pos_time.IsEmpty()) {
 		symtf_pos_time.Add(utc_time);
+		pos_from = 0;
 		return 0;
 	}
 	else {
 		const Time& latest = symtf_pos_time.Top();
 		if (latest < utc_time) {
+			pos_from = min(pos_from, symtf_pos_time.GetCount());
 			symtf_pos_time.Add(utc_time);
 			return symtf_pos_time.GetCount() - 1;
 		}
-		for(int i = symtf_pos_time.GetCount()-1; i >= 0; i--) {
-			const Time& t = symtf_pos_time[i];
-			if (t == utc_time)
-				return i;
-			if (t < utc_time)
-				break;
+		return FindShiftTf(sym, tf, utc_time, true);
+	}
+}
+
+// Sets the time vectors of several symbols at once, which is the same as adding the times one
+// by one between DataTimeBegin and DataTimeEnd, but the main time is merged only once.
+void System::DataTimeMerge(const Vector<DataTimeSource>& src) {
+	for(int tf = 0; tf < main_time.GetCount(); tf++) {
+		Vector<const Vector<Time>*> times;
+		Index<int> syms;
+		for(int i = 0; i < src.GetCount(); i++) {
+			const DataTimeSource& s = src[i];
+			if (s.tf != tf) continue;
+			pos_time[s.sym][tf] <<= *s.time;
+			pos_time_from[s.sym][tf] = INT_MAX;
+			times.Add(&pos_time[s.sym][tf]);
+			if (s.main_only && !s.main_only->IsEmpty())
+				times.Add(s.main_only);
+			syms.FindAdd(s.sym);
 		}
+		if (times.IsEmpty())
+			continue;
 		
-		return -1;
+		int from = MergeMainTime(tf, times);
+		if (from >= 0) {
+			RefreshTimeTfVectors(tf, from);
+			for(int i = 0; i < symbols.GetCount(); i++)
+				RefreshTimeSymVectors(i, tf, from, syms.Find(i) >= 0 ? 0 : INT_MAX);
+		}
+		else {
+			for(int i = 0; i < syms.GetCount(); i++)
+				RefreshTimeSymVectors(syms[i], tf, INT_MAX, 0);
+		}
+		time_store_pending = true;
 	}
 }
 
+// K-way merge of the sorted main time and the sorted time vectors. Returns the first changed
+// position or -1 if there were no new times.
+int System::MergeMainTime(int tf, const Vector<const Vector<Time>*>& times) {
+	VectorMap<Time, byte>& main_time = this->main_time[tf];
+	ASSERT(main_time_sorted[tf] == main_time.GetCount());
+	
+	Vector<Time> prev_time;
+	prev_time.SetCount(main_time.GetCount());
+	for(int i = 0; i < main_time.GetCount(); i++)
+		prev_time[i] = main_time.GetKey(i);
+	
+	// Binary heap of the list heads, the earliest time first
+	struct Head : Moveable<Head> {
+		const Time* it;
+		const Time* end;
+	};
+	Vector<Head> heap;
+	int total = prev_time.GetCount();
+	for(int i = -1; i < times.GetCount(); i++) {
+		const Vector<Time>& t = i < 0 ? prev_time : *times[i];
+		if (i >= 0) total += t.GetCount();
+		if (t.IsEmpty()) continue;
+		Head& h = heap.Add();
+		h.it = t.Begin();
+		h.end = t.End();
+	}
+	auto sift_down = [&heap](int i) {
+		int n = heap.GetCount();
+		for(;;) {
+			int min = i, l = 2 * i + 1, r = l + 1;
+			if (l < n && *heap[l].it < *heap[min].it) min = l;
+			if (r < n && *heap[r].it < *heap[min].it) min = r;
+			if (min == i) break;
+			Swap(heap[i], heap[min]);
+			i = min;
+		}
+	};
+	for(int i = heap.GetCount() / 2 - 1; i >= 0; i--)
+		sift_down(i);
+	
+	Vector<Time> merged;
+	merged.Reserve(total);
+	while (!heap.IsEmpty()) {
+		Head& top = heap[0];
+		const Time& t = *top.it;
+		if (merged.IsEmpty() || merged.Top() < t)
+			merged.Add(t);
+		if (++top.it == top.end) {
+			heap[0] = heap.Top();
+			heap.Drop();
+		}
+		if (!heap.IsEmpty())
+			sift_down(0);
+	}
+	
+	if (merged.GetCount() == prev_time.GetCount())
+		return -1;
+	
+	int from = 0;
+	while (from < prev_time.GetCount() && prev_time[from] == merged[from])
+		from++;
+	
+	main_time.Trim(from);
+	for(int i = from; i < merged.GetCount(); i++)
+		main_time.Add(merged[i], 0);
+	main_time_sorted[tf] = main_time.GetCount();
+	return from;
+}
+
 void System::AddPeriod(String nice_str, int period) {
 	int count = periods.GetCount();
 	
@@ -278,15 +574,62 @@ void System::AddSymbol(String sym) {
 	priority.Add(100000);
 }
 
-void System::RefreshTimeTfVectors(int tf) {
+// Rebuilds all conversion vectors in parallel. Each job writes the vectors of one timeframe
+// pair or one symbol and timeframe.
+void System::RefreshTimeConversions() {
+	int tf_count = main_time.GetCount();
+	CoWork co;
+	for(int i = 0; i < tf_count; i++) {
+		for(int j = i + 1; j < tf_count; j++) {
+			main_conv[i][j].Clear();
+			main_conv[j][i].Clear();
+			co & [=] {RefreshTimeTfVector(i, j);};
+		}
+	}
+	for(int i = 0; i < pos_time.GetCount(); i++) {
+		for(int j = 0; j < tf_count; j++) {
+			posconv_from[i][j].Clear();
+			posconv_to[i][j].Clear();
+			co & [=] {RefreshTimeSymVectors(i, j);};
+		}
+	}
+	co.Finish();
+}
+
+void System::RefreshTimeTfVectors(int tf, int from) {
 	
 	for(int i = 0; i < periods.GetCount(); i++) {
 		if (tf == i) continue;
-		RefreshTimeTfVector(i, tf);
+		RefreshTimeTfVector(i, tf, INT_MAX, from);
 	}
 }
 
-void System::RefreshTimeTfVector(int tf_from, int tf_to) {
+// Finds the state of the conversion walk below, where the previous walk was when it saw a time
+// at 'from0' or 'from1' first. The times and the conversions before that are still valid.
+template <class T0, class T1>
+static bool FindTimeWalkResume(const T0& time0, const T1& time1, const Vector<int>& vec0, const Vector<int>& vec1,
+                        int from0, int from1, int& c0, int& c1) {
+	int p0 = min(from0, time0.GetCount()) - 1;
+	int p1 = min(from1, time1.GetCount()) - 1;
+	if (p0 < 0 || p1 < 0 || p0 >= vec0.GetCount() || p1 >= vec1.GetCount())
+		return false;
+	
+	// The walk reached p0 at (p0, s1) and p1 at (s0, p1) first. Both coordinates only increase.
+	int s1 = vec0[p0], s0 = vec1[p1];
+	if (s1 < 0 || s0 < 0)
+		return false;
+	if (s0 < p0 || (s0 == p0 && p1 < s1)) {
+		c0 = s0;
+		c1 = p1;
+	}
+	else {
+		c0 = p0;
+		c1 = s1;
+	}
+	return true;
+}
+
+void System::RefreshTimeTfVector(int tf_from, int tf_to, int from_from, int to_from) {
 	Vector<int>& vec_from = main_conv[tf_from][tf_to];
 	Vector<int>& vec_to = main_conv[tf_to][tf_from];
 	
@@ -295,11 +638,14 @@ void System::RefreshTimeTfVector(int tf_from, int tf_to) {
 	if (time_from.IsEmpty() || time_to.IsEmpty())
 		return;
 	
+	int c0 = 0, c1 = 0;
+	bool c0_written = false, c1_written = false;
+	if (FindTimeWalkResume(time_from, time_to, vec_from, vec_to, from_from, to_from, c0, c1))
+		c0_written = c1_written = true;
+	
 	vec_from.SetCount(time_from.GetCount(), -1);
 	vec_to.SetCount(time_to.GetCount(), -1);
 	
-	int c0 = 0, c1 = 0;
-	bool c0_written = false, c1_written = false;
 	while (c0 < time_from.GetCount() && c1 < time_to.GetCount()) {
 		if (!c0_written) {vec_from[c0] = c1; c0_written = true;}
 		if (!c1_written) {vec_to[c1] = c0; c1_written = true;}
@@ -323,17 +669,20 @@ void System::RefreshTimeTfVector(int tf_from, int tf_to) {
 	}
 }
 
-void System::RefreshTimeSymVectors(int sym, int tf) {
+void System::RefreshTimeSymVectors(int sym, int tf, int main_from, int pos_from) {
 	const VectorMap<Time, byte>&	main_time		= this->main_time[tf];
 	const Vector<Time>&				pos_time		= this->pos_time[sym][tf];
 	Vector<int>&					posconv_from	= this->posconv_from[sym][tf];
 	Vector<int>&					posconv_to		= this->posconv_to[sym][tf];
 	
+	int c0 = 0, c1 = 0;
+	bool c0_written = false, c1_written = false;
+	if (FindTimeWalkResume(main_time, pos_time, posconv_to, posconv_from, main_from, pos_from, c0, c1))
+		c0_written = c1_written = true;
+	
 	posconv_from.SetCount(pos_time.GetCount(), -1);
 	posconv_to.SetCount(main_time.GetCount(), -1);
 	
-	int c0 = 0, c1 = 0;
-	bool c0_written = false, c1_written = false;
 	while (c0 < main_time.GetCount() && c1 < pos_time.GetCount()) {
 		int& to = posconv_to[c0];
 		int& from = posconv_from[c1];
@@ -368,6 +717,63 @@ int System::GetCountTf(int sym, int tf) const {
 	return pos_time[sym][tf].GetCount();
 }
 
+// Returns the position of the last bar at or before the time, or -1. The bars are mostly
+// regular, so the position is predicted from the distance to the last bar and corrected with
+// exponential and binary searches around the prediction.
+int System::FindShiftTf(int sym, int tf, Time t, bool exact) const {
+	const Vector<Time>& time = pos_time[sym][tf];
+	int count = time.GetCount();
+	if (!count || t < time[0])
+		return -1;
+	int last = count - 1;
+	if (t >= time[last])
+		return !exact || t == time[last] ? last : -1;
+	
+	// Gaps in the data make the prediction too early rather than too late
+	int64 dist = (time[last] - t) / (periods[tf] * 60);
+	int pos = (int)max<int64>(0, last - dist);
+	
+	// Find lo and hi where time[lo] <= t < time[hi]
+	int lo, hi;
+	if (time[pos] <= t) {
+		lo = pos;
+		for(int step = 1;; step *= 2) {
+			hi = lo + step;
+			if (hi >= last) {hi = last; break;}
+			if (time[hi] > t) break;
+			lo = hi;
+		}
+	}
+	else {
+		hi = pos;
+		for(int step = 1;; step *= 2) {
+			lo = hi - step;
+			if (lo <= 0) {lo = 0; break;}
+			if (time[lo] <= t) break;
+			hi = lo;
+		}
+	}
+	while (hi - lo > 1) {
+		int mid = (lo + hi) / 2;
+		if (time[mid] <= t)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return !exact || time[lo] == t ? lo : -1;
+}
+
+// Gets the positions of the bars from 'begin' to before 'end'. Returns false if there are none.
+bool System::GetShiftRangeTf(int sym, int tf, Time begin, Time end, int& first, int& last) const {
+	first = FindShiftTf(sym, tf, begin);
+	if (first < 0 || pos_time[sym][tf][first] < begin)
+		first++;
+	last = FindShiftTf(sym, tf, end);
+	if (last >= 0 && pos_time[sym][tf][last] == end)
+		last--;
+	return first <= last;
+}
+
 int System::GetShiftTf(int src_sym, int src_tf, int dst_sym, int dst_tf, int src_shift) {
 	int src_mainpos = posconv_from[src_sym][src_tf][src_shift];
 	if (src_tf != dst_tf) {
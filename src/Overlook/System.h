@@ -4,6 +4,7 @@
 namespace Config {
 extern Upp::IniString arg_addr;
 extern Upp::IniInt arg_port;
+extern Upp::IniInt core_memory_budget;
 }
 
 namespace Overlook {
@@ -189,7 +190,17 @@ struct InspectionResult : Moveable<InspectionResult> {
 	String msg;
 };
 
+// Complete time vector of a symbol and timeframe for System::DataTimeMerge. The sorted
+// 'main_only' times are added to the main time but not to the symbol, like DataTimeAdd does for
+// a time that is older than the latest time of the symbol.
+struct DataTimeSource : Moveable<DataTimeSource> {
+	int sym = -1, tf = -1;
+	const Vector<Time>* time = NULL;
+	const Vector<Time>* main_only = NULL;
+};
+
 enum {TIMEBUF_WEEKTIME, TIMEBUF_COUNT};
+enum {SYSTEMBIN_MAGIC = 0x53594231, SYSTEMBIN_VERSION = 1};
 enum {CORE_INDICATOR, CORE_EXPERTADVISOR, CORE_ACCOUNTADVISOR, CORE_HIDDEN};
 
 class System {
@@ -309,12 +320,36 @@ protected:
 	void	ConnectInput(int input_id, int output_id, CoreItem& ci, int factory, int hash);
 	void	MaskPath(const Vector<byte>& src, const Vector<int>& path, Vector<byte>& dst) const;
 	
+	// Shared state of one parallel ProcessQueue call
+	struct QueueRun {
+		Vector<Ptr<CoreItem> >*		queue = NULL;
+		Vector<Vector<int> >		dependents;
+		Vector<int>					dep_count;
+		Vector<int>					ready;
+		Mutex						lock;
+		ConditionVariable			cond;
+		String						error;
+		int							finished = 0, running = 0;
+		bool						store_cache = false, failed = false, user_error = false;
+	};
+	
+	void	ProcessQueueWorker(QueueRun* run);
+	static bool& QueueWorkerFlag();
+	void	ImportHistory(Vector<Ptr<CoreItem> >& ci_queue, int count);
+	int		MergeMainTime(int tf, const Vector<const Vector<Time>*>& times);
+	int		SpliceMainTime(int tf);
+	
 public:
 	
 	void	Process(CoreItem& ci, bool store_cache);
+	void	ProcessQueue(Vector<Ptr<CoreItem> >& ci_queue, bool store_cache);
+	static bool IsQueueWorker()						{return QueueWorkerFlag();}
+	void	CheckMemoryBudget();
 	int		GetCoreQueue(Vector<Ptr<CoreItem> >& ci_queue, const Index<int>& sym_ids, const Index<int>& tf_ids, const Vector<FactoryDeclaration>& indi_ids);
 	int		GetCountTf(int sym, int tf) const;
 	Time	GetTimeTf(int sym, int tf, int pos) const;
+	int		FindShiftTf(int sym, int tf, Time t, bool exact=false) const;
+	bool	GetShiftRangeTf(int sym, int tf, Time begin, Time end, int& first, int& last) const;
 	int		GetShiftTf(int src_sym, int src_tf, int dst_sym, int dst_tf, int shift);
 	Core*	CreateSingle(int factory, int sym, int tf);
 	void	SetEnd(const Time& t);
@@ -330,25 +365,29 @@ public:
 	Vector<Vector<Vector<int> > > posconv_from, posconv_to;
 	
 	// Temporary
-	bool main_time_changed = false;
+	Vector<int> main_time_sorted, main_time_from;
+	Vector<Vector<int> > pos_time_from;
+	TimeStop time_stored;
+	bool main_time_changed = false, time_store_pending = false;
 	
 	
-	void	Serialize(Stream& s) {
-		s % symbols % periods % period_strings % priority % spread_points % proxy_id
-		  % proxy_base_mul % sym_priority % time_offset
-		  % pos_time % main_time % main_conv % posconv_from % posconv_to;
-	}
+	void	Serialize(Stream& s);
+	void	SerializeLegacy(Stream& s);
 	
 	void	DataTimeBegin(int sym, int tf);
 	void	DataTimeEnd(int sym, int tf);
 	int		DataTimeAdd(int sym, int tf, Time utc_time);
+	void	DataTimeMerge(const Vector<DataTimeSource>& src);
 	Time	TimeFromBroker(Time t) {return t - time_offset;}
 	Time	TimeToBroker(Time t) {return t + time_offset;}
-	void	RefreshTimeTfVectors(int tf);
-	void	RefreshTimeTfVector(int tf_from, int tf_to);
-	void	RefreshTimeSymVectors(int sym, int tf);
+	void	RefreshTimeTfVectors(int tf, int from=0);
+	void	RefreshTimeTfVector(int tf_from, int tf_to, int from_from=0, int to_from=0);
+	void	RefreshTimeSymVectors(int sym, int tf, int main_from=0, int pos_from=0);
+	void	RefreshTimeConversions();
+	void	InitTimeState();
+	void	StorePendingTime();
 	void	LoadThis() {LoadFromFile(*this, ConfigFile("system.bin"));}
-	void	StoreThis() {StoreToFile(*this, ConfigFile("system.bin"));}
+	void	StoreThis() {StoreToFile(*this, ConfigFile("system.bin")); time_store_pending = false; time_stored.Reset();}
 	int		GetCountMain(int tf) const {return main_time[tf].GetCount();}
 	Time	GetTimeMain(int tf, int i) const {return main_time[tf].GetKey(i);}
 	int		GetShiftFromMain(int sym, int tf, int i) const {return posconv_to[sym][tf][i];}
@@ -402,14 +402,182 @@ Core* System::CreateSingle(int factory, int sym, int tf) {
 	GetCoreQueue(path, ci_queue, tf, sym_ids);
 	
 	// Process job-queue
-	for(int i = 0; i < ci_queue.GetCount(); i++) {
-		WhenProgress(i, ci_queue.GetCount());
-		Process(*ci_queue[i], true);
-	}
+	ProcessQueue(ci_queue, true);
 	
 	return &*ci_queue.Top()->core;
 }
 
+void System::ProcessQueue(Vector<Ptr<CoreItem> >& ci_queue, bool store_cache) {
+	int count = ci_queue.GetCount();
+	
+	#ifdef flagGUITASK
+	for(int i = 0; i < count; i++) {
+		WhenProgress(i, count);
+		Process(*ci_queue[i], store_cache);
+	}
+	StorePendingTime();
+	CheckMemoryBudget();
+	#else
+	
+	// DataBridges share the time axis of the system, so they are processed serially first.
+	// Their history files are parsed in parallel before that.
+	int db_factory = Find<DataBridge>();
+	int serial_count = 0;
+	while (serial_count < count && ci_queue[serial_count]->factory == db_factory)
+		serial_count++;
+	ImportHistory(ci_queue, serial_count);
+	for(int i = 0; i < serial_count; i++) {
+		WhenProgress(i, count);
+		Process(*ci_queue[i], store_cache);
+	}
+	StorePendingTime();
+	if (serial_count == count) {
+		CheckMemoryBudget();
+		return;
+	}
+	
+	// Connect dependencies inside the queue
+	QueueRun run;
+	run.queue = &ci_queue;
+	run.store_cache = store_cache;
+	run.finished = serial_count;
+	run.dependents.SetCount(count);
+	run.dep_count.SetCount(count, 0);
+	Index<CoreItem*> queue_ids;
+	for(int i = 0; i < count; i++)
+		queue_ids.Add(&*ci_queue[i]);
+	for(int i = serial_count; i < count; i++) {
+		const CoreItem& ci = *ci_queue[i];
+		Index<int> deps;
+		for(int j = 0; j < ci.inputs.GetCount(); j++) {
+			const InputDef& in = ci.inputs[j];
+			for(int k = 0; k < in.GetCount(); k++) {
+				int dep = queue_ids.Find(in[k].coreitem);
+				if (dep >= serial_count && dep != i)
+					deps.FindAdd(dep);
+			}
+		}
+		for(int j = 0; j < deps.GetCount(); j++)
+			run.dependents[deps[j]].Add(i);
+		run.dep_count[i] = deps.GetCount();
+		if (deps.IsEmpty())
+			run.ready.Add(i);
+	}
+	
+	// Run independent items in worker threads
+	int thread_count = min(GetUsedCpuCores(), count - serial_count);
+	Array<Thread> workers;
+	for(int i = 0; i < thread_count; i++)
+		workers.Add().Run(THISBACK1(ProcessQueueWorker, &run));
+	for(int i = 0; i < workers.GetCount(); i++)
+		workers[i].Wait();
+	
+	if (run.failed) {
+		if (run.user_error)
+			throw UserExc(run.error);
+		throw DataExc(run.error);
+	}
+	
+	CheckMemoryBudget();
+	#endif
+}
+
+// DataBridges have been processed by the serial phase when the queue workers run
+bool& System::QueueWorkerFlag() {
+	static thread_local bool is_worker;
+	return is_worker;
+}
+
+void System::ProcessQueueWorker(QueueRun* run) {
+	const int count = run->queue->GetCount();
+	QueueWorkerFlag() = true;
+	
+	while (!Thread::IsShutdownThreads()) {
+		int id = -1;
+		
+		// Wait until an item is ready or all items have been taken
+		LOCK(run->lock) {
+			while (!run->failed && run->ready.IsEmpty() && run->finished + run->running < count)
+				run->cond.Wait(run->lock);
+			if (!run->failed && !run->ready.IsEmpty()) {
+				// Prefer the original priority order
+				int pos = 0;
+				for(int i = 1; i < run->ready.GetCount(); i++)
+					if (run->ready[i] < run->ready[pos])
+						pos = i;
+				id = run->ready[pos];
+				run->ready.Remove(pos);
+				run->running++;
+			}
+		}
+		
+		if (id == -1)
+			break;
+		
+		bool succ = true;
+		try {
+			Process(*(*run->queue)[id], run->store_cache);
+		}
+		catch (UserExc e) {
+			LOCK(run->lock) {
+				run->error = e;
+				run->user_error = true;
+				run->failed = true;
+			}
+			succ = false;
+		}
+		catch (Exc e) {
+			LOCK(run->lock) {
+				run->error = e;
+				run->failed = true;
+			}
+			succ = false;
+		}
+		
+		LOCK(run->lock) {
+			run->running--;
+			if (succ) {
+				run->finished++;
+				const Vector<int>& dependents = run->dependents[id];
+				for(int i = 0; i < dependents.GetCount(); i++)
+					if (--run->dep_count[dependents[i]] == 0)
+						run->ready.Add(dependents[i]);
+				WhenProgress(run->finished, count);
+			}
+			run->cond.Broadcast();
+		}
+	}
+	QueueWorkerFlag() = false;
+}
+
+// Parses the history files of the DataBridges in parallel into private buffers and merges their
+// times to the main time at once. The DataBridges take the parsed data when they are processed.
+void System::ImportHistory(Vector<Ptr<CoreItem> >& ci_queue, int count) {
+	Vector<DataBridge*> dbs;
+	for(int i = 0; i < count; i++) {
+		CoreItem& ci = *ci_queue[i];
+		if (ci.core.IsEmpty())
+			CreateCore(ci);
+		DataBridge* db = dynamic_cast<DataBridge*>(&*ci.core);
+		if (db && db->BeginHistoryImport())
+			dbs.Add(db);
+	}
+	if (dbs.IsEmpty())
+		return;
+	
+	CoWork co;
+	for(int i = 0; i < dbs.GetCount(); i++) {
+		DataBridge* db = dbs[i];
+		co & [=] {db->ParseHistoryImport();};
+	}
+	co.Finish();
+	
+	Vector<DataTimeSource> src;
+	for(int i = 0; i < dbs.GetCount(); i++)
+		dbs[i]->GetHistoryTime(src);
+	DataTimeMerge(src);
+}
+
 void System::Process(CoreItem& ci, bool store_cache) {
 	
 	// Load dependencies to the scope
@@ -417,6 +585,7 @@ void System::Process(CoreItem& ci, bool store_cache) {
 		CreateCore(ci);
 	
 	// Process core-object
+	ci.core->SetLastAccess(msecs());
 	ci.core->Refresh();
 	
 	// Store cache file
@@ -425,6 +594,53 @@ void System::Process(CoreItem& ci, bool store_cache) {
 	
 }
 
+void System::CheckMemoryBudget() {
+	int64 budget = (int64)Config::core_memory_budget * 1024 * 1024;
+	if (budget <= 0)
+		return;
+	
+	// Collect created cores and keep sources of running jobs resident
+	Vector<Core*> cores;
+	Index<Core*> pinned;
+	int64 total = 0;
+	for(int i = 0; i < data.GetCount(); i++) {
+		for(int j = 0; j < data[i].GetCount(); j++) {
+			for(int k = 0; k < data[i][j].GetCount(); k++) {
+				ArrayMap<int, CoreItem>& items = data[i][j][k];
+				for(int l = 0; l < items.GetCount(); l++) {
+					CoreItem& ci = items[l];
+					if (ci.core.IsEmpty())
+						continue;
+					Core& c = *ci.core;
+					total += c.GetMemoryUsage();
+					cores.Add(&c);
+					if (!c.jobs.IsEmpty() && pinned.Find(&c) == -1) {
+						Vector<Core*> sources;
+						pinned.Add(&c);
+						c.GetSourcesDeep(pinned, sources);
+					}
+				}
+			}
+		}
+	}
+	if (total <= budget)
+		return;
+	
+	// Release least recently used cores until the budget is met
+	struct AccessSorter {
+		bool operator()(const Core* a, const Core* b) const {return a->GetLastAccess() < b->GetLastAccess();}
+	};
+	Sort(cores, AccessSorter());
+	for(int i = 0; i < cores.GetCount() && total > budget; i++) {
+		Core& c = *cores[i];
+		if (pinned.Find(&c) != -1)
+			continue;
+		int64 before = c.GetMemoryUsage();
+		if (before > 0 && c.ReleaseMemory())
+			total -= before - c.GetMemoryUsage();
+	}
+}
+
 #ifdef flagGUITASK
 
 void System::ProcessJobs() {
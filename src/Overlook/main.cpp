@@ -11,6 +11,9 @@ INI_BOOL(use_internet_m1_data, false, "Download M1 data from Internet")
 INI_BOOL(wait_mt4, false, "Wait for MT4 to respond")
 INI_STRING(arg_addr, "127.0.0.1", "Host address");
 INI_INT(arg_port, 42000, "Host port");
+INI_BOOL(compress_corecache, false, "Compress values in the core cache");
+INI_INT(core_memory_budget, 0, "Memory budget of core values in megabytes (0 is unlimited)");
+INI_INT(dqn_training_threads, 0, "Threads of the advisor training (0 is default, 1 is deterministic)");
 };
 
 struct LoaderWindow : public TopWindow {